@@ -0,0 +1,396 @@
+#ifndef JsonFileH
+#define JsonFileH
+#include "JsonSink.h"
+#include <condition_variable>
+
+//Append-only JSON files on POSIX descriptors.
+namespace Json
+{
+	namespace details
+	{
+		//Stream buffer appending to a caller-owned string, so records are serialized
+		//straight into a reused batch buffer.
+		class StringBuffer : public std::streambuf {
+		private:
+			std::string* out;
+		protected:
+			virtual int_type overflow(int_type ch) override {
+				if (!traits_type::eq_int_type(ch, traits_type::eof()))
+					out->push_back(traits_type::to_char_type(ch));
+				return traits_type::not_eof(ch);
+			}
+
+			virtual std::streamsize xsputn(const char* data, std::streamsize count) override {
+				out->append(data, static_cast<size_t>(count));
+				return count;
+			}
+		public:
+			explicit StringBuffer(std::string& out)
+				:out(&out) {}
+		};
+	}
+
+	//When a batched file writes what it has collected: as soon as the batch holds
+	//maxRecords records or maxBytes bytes, or its oldest record is maxLatency old.
+	//A zero maxLatency sets no deadline. Only ArrayFile and DurableLog take a policy:
+	//FdSink and SpillSink write their buffer when it fills or on flush(), however
+	//long the buffered bytes have waited.
+	struct BatchPolicy {
+		size_t maxRecords = 64;
+		size_t maxBytes = 1 << 16;
+		std::chrono::microseconds maxLatency{ 0 };
+
+		BatchPolicy() {}
+
+		BatchPolicy(size_t maxRecords, size_t maxBytes, std::chrono::microseconds maxLatency = std::chrono::microseconds(0))
+			:maxRecords(maxRecords ? maxRecords : 1), maxBytes(maxBytes), maxLatency(maxLatency) {}
+	};
+
+	//File holding a single JSON array that is valid after every flush. A batch of
+	//records replaces the closing "]\n" with ",\n<record>...]\n" in one pwrite, so
+	//earlier records are never rewritten nor kept in memory. Reopening the file scans
+	//it, and after a crash a torn tail is cut back to the last complete record.
+	//With a maxLatency deadline a timer thread flushes batches left waiting by a quiet
+	//stream; the file is then safe to append to from several threads.
+	//Json::ArrayFile audit("audit.json", { 64, 1 << 16, std::chrono::milliseconds(50) });
+	class ArrayFile {
+	private:
+		int fd;
+		off_t tail = 1;
+		bool separate = false;
+		BatchPolicy policy;
+		size_t batched = 0;
+		std::string batch;
+		details::StringBuffer buffer;
+		std::ostream os;
+		mutable std::mutex mutex;
+		std::condition_variable timerWake;
+		std::chrono::steady_clock::time_point oldest;
+		bool stopping = false;
+		int error = 0;
+		std::thread timer;
+
+		[[noreturn]] void fail(const std::string& what) {
+			int error = errno;
+			if (fd >= 0)
+				::close(fd);
+			fd = -1;
+			throw std::system_error(error, std::generic_category(), what);
+		}
+
+		//Whether the next record needs a comma: the last non-whitespace byte before end
+		//is neither the opening bracket nor a separator already there.
+		bool needsSeparator(const std::string& path, off_t end) {
+			char chunk[256];
+			while (end > 0) {
+				size_t step = end < static_cast<off_t>(sizeof(chunk)) ? static_cast<size_t>(end) : sizeof(chunk);
+				end -= static_cast<off_t>(step);
+				if (!details::preadAll(fd, chunk, step, end))
+					fail("cannot read " + path);
+				for (size_t i = step; i-- > 0;)
+					if (static_cast<unsigned char>(chunk[i]) > 0x20)
+						return chunk[i] != '[' && chunk[i] != ',';
+			}
+			return false;
+		}
+
+		//Scans for the closing bracket or, in a torn file, the end of the last complete
+		//element. Ending in "]\n" proves nothing: a torn batch can stop right after a
+		//"]\n" inside a string or a Raw fragment, so the tail is only trusted when the
+		//scan closes the array there.
+		void recover(const std::string& path, off_t size) {
+			char edge[2];
+			if (!details::preadAll(fd, edge, 1, 0))
+				fail("cannot read " + path);
+			if (edge[0] != '[') {
+				::close(fd);
+				throw std::runtime_error(path + " does not hold a JSON array");
+			}
+			off_t complete = 1;
+			long depth = 0;
+			bool inString = false;
+			bool escaped = false;
+			bool closed = false;
+			char chunk[1 << 16];
+			for (off_t at = 1; at < size && !closed;) {
+				size_t step = static_cast<size_t>(size - at) < sizeof(chunk) ? static_cast<size_t>(size - at) : sizeof(chunk);
+				if (!details::preadAll(fd, chunk, step, at))
+					fail("cannot read " + path);
+				for (size_t i = 0; i < step && !closed; ++i) {
+					char ch = chunk[i];
+					off_t position = at + static_cast<off_t>(i);
+					if (inString) {
+						if (escaped)
+							escaped = false;
+						else if (ch == '\\')
+							escaped = true;
+						else if (ch == '\"')
+							inString = false;
+					}
+					else if (ch == '\"')
+						inString = true;
+					else if (ch == '{' || ch == '[')
+						++depth;
+					else if (ch == '}' || ch == ']') {
+						if (depth == 0) {
+							complete = position;
+							closed = true;
+						}
+						else if (--depth == 0)
+							complete = position + 1;
+					}
+					else if (ch == ',' && depth == 0)
+						complete = position;
+				}
+				at += static_cast<off_t>(step);
+			}
+
+			bool intact = closed && complete == size - 2 && details::preadAll(fd, edge, 2, complete) && edge[1] == '\n';
+			if (!intact && (::ftruncate(fd, complete) != 0 || !details::pwriteAll(fd, "]\n", 2, complete)))
+				fail("cannot repair " + path);
+			tail = complete;
+			separate = needsSeparator(path, tail);
+		}
+
+		void flushLocked() {
+			if (error)
+				throw std::system_error(error, std::generic_category(), "ArrayFile flush failed");
+			if (batched == 0)
+				return;
+			batch += "]\n";
+			if (!details::pwriteAll(fd, batch.data(), batch.size(), tail)) {
+				batch.resize(batch.size() - 2);
+				throw std::system_error(errno, std::generic_category(), "ArrayFile flush failed");
+			}
+			tail += static_cast<off_t>(batch.size() - 2);
+			batch.clear();
+			batched = 0;
+		}
+
+		//Sleeps until the oldest pending record reaches its deadline. A failed write is
+		//kept and reported by the next append or flush instead of being retried here.
+		void timerLoop() {
+			std::unique_lock<std::mutex> lock(mutex);
+			while (!stopping) {
+				if (batched == 0 || error) {
+					timerWake.wait(lock);
+					continue;
+				}
+				auto deadline = oldest + policy.maxLatency;
+				if (timerWake.wait_until(lock, deadline) != std::cv_status::timeout || batched == 0 || oldest + policy.maxLatency > std::chrono::steady_clock::now())
+					continue;
+				try {
+					flushLocked();
+				}
+				catch (const std::system_error& failure) {
+					error = failure.code().value();
+				}
+			}
+		}
+	public:
+		explicit ArrayFile(const std::string& path, BatchPolicy policy = BatchPolicy())
+			:fd(::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644)), policy(policy), buffer(batch), os(&buffer) {
+			if (fd < 0)
+				fail("cannot open " + path);
+			struct stat st;
+			if (::fstat(fd, &st) != 0)
+				fail("cannot stat " + path);
+			if (st.st_size == 0) {
+				if (!details::pwriteAll(fd, "[]\n", 3, 0))
+					fail("cannot write " + path);
+			}
+			else
+				recover(path, st.st_size);
+			if (policy.maxLatency.count() > 0)
+				timer = std::thread(&ArrayFile::timerLoop, this);
+		}
+
+		ArrayFile(const ArrayFile&) = delete;
+		ArrayFile& operator=(const ArrayFile&) = delete;
+
+		~ArrayFile() {
+			if (timer.joinable()) {
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					stopping = true;
+				}
+				timerWake.notify_one();
+				timer.join();
+			}
+			try {
+				flush();
+			}
+			catch (const std::system_error&) {
+			}
+			::close(fd);
+		}
+
+		ArrayFile& append(const Node& record) {
+			std::lock_guard<std::mutex> lock(mutex);
+			if (error)
+				throw std::system_error(error, std::generic_category(), "ArrayFile flush failed");
+			if (separate)
+				batch += ",\n";
+			separate = true;
+			os << record;
+			if (batched++ == 0 && timer.joinable()) {
+				oldest = std::chrono::steady_clock::now();
+				timerWake.notify_one();
+			}
+			if (batched >= policy.maxRecords || batch.size() >= policy.maxBytes)
+				flushLocked();
+			return *this;
+		}
+
+		//Writes the pending batch; readers see the records from here on.
+		void flush() {
+			std::lock_guard<std::mutex> lock(mutex);
+			flushLocked();
+		}
+
+		//Flushes and waits until the records are on stable storage.
+		void sync() {
+			flush();
+			if (::fdatasync(fd) != 0)
+				throw std::system_error(errno, std::generic_category(), "ArrayFile sync failed");
+		}
+
+		size_t pending() const {
+			std::lock_guard<std::mutex> lock(mutex);
+			return batched;
+		}
+	};
+
+	//NDJSON file where a record is on stable storage before append() returns. Producers
+	//serialize on their own thread and queue the line; a committer thread writes all
+	//queued lines at once, issues one fdatasync for the group and releases its producers.
+	//A maxLatency deadline lets the committer wait for a fuller group, trading commit
+	//latency for throughput; without one it commits whatever is queued right away.
+	class DurableLog {
+	public:
+		struct Stats {
+			unsigned long long records = 0;
+			unsigned long long groups = 0;
+			unsigned long long bytes = 0;
+			std::chrono::nanoseconds commitTime{ 0 };	//write + fdatasync, summed over groups
+			std::chrono::nanoseconds maxCommit{ 0 };
+			size_t maxGroup = 0;
+		};
+	private:
+		int fd;
+		BatchPolicy policy;
+		mutable std::mutex mutex;
+		std::condition_variable wake;
+		std::condition_variable committed;
+		std::string queue;
+		std::string group;
+		unsigned long long queued = 0;
+		unsigned long long durable = 0;
+		std::chrono::steady_clock::time_point oldest;
+		bool stopping = false;
+		int error = 0;
+		Stats counters;
+		std::thread committer;
+
+		void commitLoop() {
+			std::unique_lock<std::mutex> lock(mutex);
+			for (;;) {
+				wake.wait(lock, [this]() { return stopping || !queue.empty(); });
+				if (queue.empty())
+					break;
+				if (policy.maxLatency.count() > 0) {
+					wake.wait_until(lock, oldest + policy.maxLatency, [this]() {
+						return stopping || queue.size() >= policy.maxBytes || queued - durable >= policy.maxRecords;
+					});
+				}
+
+				group.clear();
+				group.swap(queue);
+				unsigned long long last = queued;
+				size_t records = static_cast<size_t>(last - durable);
+				lock.unlock();
+
+				auto begin = std::chrono::steady_clock::now();
+				bool ok = error == 0 && details::writeAll(fd, group.data(), group.size()) && ::fdatasync(fd) == 0;
+				int failure = ok ? 0 : errno;
+				auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin);
+
+				lock.lock();
+				if (!ok && error == 0)
+					error = failure ? failure : EIO;
+				durable = last;
+				counters.records += records;
+				counters.groups += 1;
+				counters.bytes += group.size();
+				counters.commitTime += elapsed;
+				if (elapsed > counters.maxCommit)
+					counters.maxCommit = elapsed;
+				if (records > counters.maxGroup)
+					counters.maxGroup = records;
+				committed.notify_all();
+			}
+		}
+	public:
+		explicit DurableLog(const std::string& path, BatchPolicy policy = BatchPolicy())
+			:fd(::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644)), policy(policy) {
+			if (fd < 0)
+				throw std::system_error(errno, std::generic_category(), "cannot open " + path);
+			committer = std::thread(&DurableLog::commitLoop, this);
+		}
+
+		DurableLog(const DurableLog&) = delete;
+		DurableLog& operator=(const DurableLog&) = delete;
+
+		//Commits what is queued, then stops the committer.
+		~DurableLog() {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stopping = true;
+			}
+			wake.notify_one();
+			committer.join();
+			::close(fd);
+		}
+
+		//Queues the record and returns its sequence number without waiting.
+		unsigned long long write(const Node& record) {
+			thread_local std::string line;
+			line.clear();
+			details::StringBuffer buffer(line);
+			std::ostream os(&buffer);
+			os << record << '\n';
+
+			unsigned long long sequence;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (error)
+					throw std::system_error(error, std::generic_category(), "DurableLog commit failed");
+				if (queue.empty())
+					oldest = std::chrono::steady_clock::now();
+				queue += line;
+				sequence = ++queued;
+			}
+			wake.notify_one();
+			return sequence;
+		}
+
+		//Blocks until the record with this sequence number is durable.
+		void wait(unsigned long long sequence) {
+			std::unique_lock<std::mutex> lock(mutex);
+			committed.wait(lock, [this, sequence]() { return durable >= sequence; });
+			if (error)
+				throw std::system_error(error, std::generic_category(), "DurableLog commit failed");
+		}
+
+		void append(const Node& record) {
+			wait(write(record));
+		}
+
+		Stats stats() const {
+			std::lock_guard<std::mutex> lock(mutex);
+			return counters;
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,520 @@
+#ifndef JsonLogH
+#define JsonLogH
+#include "JsonFile.h"
+#include <deque>
+#include <fstream>
+
+//Deferred structured logging: a producer copies the event id, a timestamp and the raw
+//argument bytes into its own ring buffer and returns; a background thread turns the
+//records into JSON with the writer, or appends them unformatted to a binary spill file
+//that decodeLog converts to NDJSON offline.
+//  static const Json::LogEvent filled("order_filled", { "id", "price", "venue" });
+//  Json::Logger log(std::cout);
+//  log.log(filled, orderId, price, "XNAS");
+namespace Json
+{
+	namespace details
+	{
+		enum class LogTag : char {
+			Int = 1,
+			UInt = 2,
+			Double = 3,
+			Bool = 4,
+			String = 5
+		};
+
+		//Record: uint32 size, uint32 event, int64 nanoseconds since the epoch, then
+		//per argument a tag and its bytes (strings as uint32 length + bytes).
+		const size_t logHeader = 16;
+		const uint32_t logPadding = 0xFFFFFFFF;
+		const uint32_t logDefinition = 0;
+		const char logMagic[8] = { 'J', 'W', 'L', 'O', 'G', '1', '\n', '\0' };
+
+		template<typename T>
+		inline void putRaw(char*& at, T value) noexcept {
+			std::memcpy(at, &value, sizeof(T));
+			at += sizeof(T);
+		}
+
+		template<typename T>
+		inline T getRaw(const char*& at) noexcept {
+			T value;
+			std::memcpy(&value, at, sizeof(T));
+			at += sizeof(T);
+			return value;
+		}
+
+		template<typename T>
+		inline size_t logSize(const T& value) noexcept {
+			if constexpr (std::is_same<T, bool>::value || std::is_arithmetic<T>::value || std::is_enum<T>::value)
+				return 1 + (std::is_same<T, bool>::value ? 1 : 8);
+			else
+				return 1 + 4 + std::string_view(value).size();
+		}
+
+		template<typename T>
+		inline void logPut(char*& at, const T& value) noexcept {
+			if constexpr (std::is_same<T, bool>::value) {
+				*at++ = static_cast<char>(LogTag::Bool);
+				*at++ = value ? 1 : 0;
+			}
+			else if constexpr (std::is_enum<T>::value)
+				logPut(at, static_cast<std::underlying_type_t<T>>(value));
+			else if constexpr (std::is_floating_point<T>::value) {
+				*at++ = static_cast<char>(LogTag::Double);
+				putRaw(at, static_cast<double>(value));
+			}
+			else if constexpr (std::is_integral<T>::value && std::is_signed<T>::value) {
+				*at++ = static_cast<char>(LogTag::Int);
+				putRaw(at, static_cast<int64_t>(value));
+			}
+			else if constexpr (std::is_integral<T>::value) {
+				*at++ = static_cast<char>(LogTag::UInt);
+				putRaw(at, static_cast<uint64_t>(value));
+			}
+			else {
+				std::string_view text(value);
+				*at++ = static_cast<char>(LogTag::String);
+				putRaw(at, static_cast<uint32_t>(text.size()));
+				std::memcpy(at, text.data(), text.size());
+				at += text.size();
+			}
+		}
+
+		//Single producer, single consumer byte ring. Records never wrap: when one does
+		//not fit before the end, the rest is filled with a padding record.
+		class LogRing {
+		private:
+			std::unique_ptr<char[]> data;
+			size_t capacity;
+			alignas(64) std::atomic<size_t> head{ 0 };
+			alignas(64) std::atomic<size_t> tail{ 0 };
+			size_t cachedHead = 0;
+			size_t reserved = 0;
+		public:
+			std::atomic<unsigned long long> dropped{ 0 };
+
+			explicit LogRing(size_t bytes)
+				:capacity(4096) {
+				while (capacity < bytes)
+					capacity *= 2;
+				data.reset(new char[capacity]);
+			}
+
+			//Space for size bytes, nullptr when the consumer is too far behind.
+			char* reserve(size_t size) noexcept {
+				size = (size + 7) & ~static_cast<size_t>(7);
+				size_t at = tail.load(std::memory_order_relaxed);
+				size_t offset = at & (capacity - 1);
+				size_t skip = capacity - offset < size ? capacity - offset : 0;
+				if (size > capacity / 2)
+					return nullptr;
+				if (at + skip + size - cachedHead > capacity) {
+					cachedHead = head.load(std::memory_order_acquire);
+					if (at + skip + size - cachedHead > capacity)
+						return nullptr;
+				}
+				if (skip) {
+					char* padding = data.get() + offset;
+					putRaw(padding, static_cast<uint32_t>(skip));
+					putRaw(padding, logPadding);
+					at += skip;
+					offset = 0;
+				}
+				reserved = at + size;
+				return data.get() + offset;
+			}
+
+			void commit() noexcept {
+				tail.store(reserved, std::memory_order_release);
+			}
+
+			//Calls consume(record, size) for every committed record; false when there were none.
+			template<typename F>
+			bool drain(F&& consume) {
+				size_t from = head.load(std::memory_order_relaxed);
+				size_t to = tail.load(std::memory_order_acquire);
+				if (from == to)
+					return false;
+				while (from < to) {
+					const char* record = data.get() + (from & (capacity - 1));
+					const char* at = record;
+					uint32_t size = getRaw<uint32_t>(at);
+					if (getRaw<uint32_t>(at) != logPadding)
+						consume(record, static_cast<size_t>(size));
+					from += (static_cast<size_t>(size) + 7) & ~static_cast<size_t>(7);
+					head.store(from, std::memory_order_release);
+				}
+				return true;
+			}
+		};
+
+		struct LogDefinition {
+			std::string name;
+			std::vector<std::string> fields;
+		};
+
+		//Events of the process, indexed by id - 1. Entries never move or change.
+		struct LogRegistry {
+			std::mutex mutex;
+			std::deque<LogDefinition> events;
+
+			static LogRegistry& instance() {
+				static LogRegistry registry;
+				return registry;
+			}
+		};
+
+		inline bool readString(const char*& at, const char* end, std::string& out) {
+			if (end - at < 4)
+				return false;
+			uint32_t size = getRaw<uint32_t>(at);
+			if (static_cast<size_t>(end - at) < size)
+				return false;
+			out.assign(at, size);
+			at += size;
+			return true;
+		}
+
+		//Formats one data record as an NDJSON line; false when it is malformed.
+		inline bool formatLogRecord(std::ostream& os, const char* record, size_t size, const LogDefinition* event, uint32_t id) {
+			if (size < logHeader)
+				return false;
+			const char* at = record + 8;
+			const char* end = record + size;
+			Object line;
+			line("time", std::chrono::time_point<std::chrono::system_clock, std::chrono::nanoseconds>(std::chrono::nanoseconds(getRaw<int64_t>(at))));
+			line("event", event ? event->name : "event" + std::to_string(id));
+			for (size_t field = 0; at < end; ++field) {
+				std::string name = event && field < event->fields.size() ? event->fields[field] : "arg" + std::to_string(field);
+				LogTag tag = static_cast<LogTag>(*at++);
+				size_t need = tag == LogTag::Bool ? 1 : tag == LogTag::String ? 4 : 8;
+				if (static_cast<size_t>(end - at) < need)
+					return false;
+				switch (tag) {
+				case LogTag::Int:
+					line(std::move(name), static_cast<long long>(getRaw<int64_t>(at)));
+					break;
+				case LogTag::UInt:
+					line(std::move(name), static_cast<unsigned long long>(getRaw<uint64_t>(at)));
+					break;
+				case LogTag::Double:
+					line(std::move(name), getRaw<double>(at));
+					break;
+				case LogTag::Bool:
+					line(std::move(name), *at++ != 0);
+					break;
+				case LogTag::String: {
+					std::string text;
+					if (!readString(at, end, text))
+						return false;
+					line(std::move(name), std::move(text));
+					break;
+				}
+				default:
+					return false;
+				}
+			}
+			os << line << '\n';
+			return true;
+		}
+	}
+
+	//Named event with the names of its arguments, registered once per process.
+	class LogEvent {
+	private:
+		uint32_t eventId;
+	public:
+		LogEvent(std::string name, std::vector<std::string> fields = {}) {
+			details::LogRegistry& registry = details::LogRegistry::instance();
+			std::lock_guard<std::mutex> lock(registry.mutex);
+			registry.events.push_back(details::LogDefinition{ std::move(name), std::move(fields) });
+			eventId = static_cast<uint32_t>(registry.events.size());
+		}
+
+		uint32_t id() const {
+			return eventId;
+		}
+	};
+
+	//Logging frontend. log() never blocks and never formats: when the calling thread's
+	//ring is full the record is dropped and counted. Rings live as long as the Logger.
+	//The first failed write of the output is kept: from then on records are counted as
+	//failed instead of written, and flush() throws the error.
+	class Logger {
+	private:
+		std::ostream* out = nullptr;
+		int spillFd = -1;
+		size_t ringBytes;
+		unsigned long long session;
+
+		std::mutex ringsMutex;
+		std::vector<std::unique_ptr<details::LogRing>> rings;
+
+		std::mutex mutex;
+		std::condition_variable wake;
+		std::condition_variable served;
+		unsigned long long requested = 0;
+		unsigned long long completed = 0;
+		bool stopping = false;
+		std::thread worker;
+
+		std::vector<const details::LogDefinition*> known;
+		std::vector<bool> spilledDefinitions;
+		std::string spill;
+		unsigned long long batched = 0;
+		std::atomic<int> error{ 0 };
+		std::atomic<unsigned long long> lost{ 0 };
+
+		static unsigned long long nextSession() {
+			static std::atomic<unsigned long long> sessions{ 0 };
+			return ++sessions;
+		}
+
+		details::LogRing& localRing() {
+			thread_local std::vector<std::pair<unsigned long long, details::LogRing*>> mine;
+			if (!mine.empty() && mine.back().first == session)
+				return *mine.back().second;
+			for (auto& entry : mine) {
+				if (entry.first == session) {
+					std::swap(entry, mine.back());
+					return *mine.back().second;
+				}
+			}
+			std::lock_guard<std::mutex> lock(ringsMutex);
+			rings.emplace_back(new details::LogRing(ringBytes));
+			mine.emplace_back(session, rings.back().get());
+			return *rings.back();
+		}
+
+		const details::LogDefinition* definition(uint32_t id) {
+			if (id == 0)
+				return nullptr;
+			if (id > known.size()) {
+				details::LogRegistry& registry = details::LogRegistry::instance();
+				std::lock_guard<std::mutex> lock(registry.mutex);
+				while (known.size() < registry.events.size())
+					known.push_back(&registry.events[known.size()]);
+			}
+			return id <= known.size() ? known[id - 1] : nullptr;
+		}
+
+		void spillDefinition(uint32_t id, const details::LogDefinition& event) {
+			size_t size = 8 + 4 + 4 + event.name.size() + 4;
+			for (const std::string& field : event.fields)
+				size += 4 + field.size();
+			size_t start = spill.size();
+			spill.resize(start + size);
+			char* at = &spill[start];
+			details::putRaw(at, static_cast<uint32_t>(size));
+			details::putRaw(at, details::logDefinition);
+			details::putRaw(at, id);
+			details::putRaw(at, static_cast<uint32_t>(event.name.size()));
+			std::memcpy(at, event.name.data(), event.name.size());
+			at += event.name.size();
+			details::putRaw(at, static_cast<uint32_t>(event.fields.size()));
+			for (const std::string& field : event.fields) {
+				details::putRaw(at, static_cast<uint32_t>(field.size()));
+				std::memcpy(at, field.data(), field.size());
+				at += field.size();
+			}
+		}
+
+		void consume(const char* record, size_t size) {
+			const char* at = record + 4;
+			uint32_t id = details::getRaw<uint32_t>(at);
+			const details::LogDefinition* event = definition(id);
+			++batched;
+			if (out) {
+				details::formatLogRecord(*out, record, size, event, id);
+				return;
+			}
+			if (event) {
+				if (spilledDefinitions.size() < id + 1)
+					spilledDefinitions.resize(id + 1);
+				if (!spilledDefinitions[id]) {
+					spillDefinition(id, *event);
+					spilledDefinitions[id] = true;
+				}
+			}
+			spill.append(record, size);
+		}
+
+		//Drains every ring once; false when all of them were empty.
+		bool pass() {
+			std::vector<details::LogRing*> current;
+			{
+				std::lock_guard<std::mutex> lock(ringsMutex);
+				for (auto& ring : rings)
+					current.push_back(ring.get());
+			}
+			bool any = false;
+			for (details::LogRing* ring : current)
+				any = ring->drain([this](const char* record, size_t size) { consume(record, size); }) || any;
+			if (out) {
+				out->flush();
+				if (error.load(std::memory_order_relaxed) == 0 && out->fail())
+					error = EIO;
+			}
+			else if (!spill.empty()) {
+				//After a failed write the file may end in a partial record, so nothing
+				//more is appended to it.
+				if (error.load(std::memory_order_relaxed) == 0 && !details::writeAll(spillFd, spill.data(), spill.size()))
+					error = errno ? errno : EIO;
+				spill.clear();
+			}
+			if (error.load(std::memory_order_relaxed) != 0)
+				lost.fetch_add(batched, std::memory_order_relaxed);
+			batched = 0;
+			return any;
+		}
+
+		void run() {
+			std::unique_lock<std::mutex> lock(mutex);
+			for (;;) {
+				unsigned long long target = requested;
+				bool stop = stopping;
+				lock.unlock();
+				bool any = pass();
+				lock.lock();
+				completed = target;
+				served.notify_all();
+				if (stop && !any)
+					break;
+				if (!any && requested == target && !stopping)
+					wake.wait_for(lock, std::chrono::milliseconds(1));
+			}
+		}
+
+		void start() {
+			session = nextSession();
+			worker = std::thread(&Logger::run, this);
+		}
+	public:
+		//Formats records as NDJSON into out, which only the background thread touches.
+		explicit Logger(std::ostream& out, size_t ringBytes = 1 << 20)
+			:out(&out), ringBytes(ringBytes) {
+			start();
+		}
+
+		//Appends unformatted records to a binary spill file; see decodeLog.
+		explicit Logger(const std::string& spillPath, size_t ringBytes = 1 << 20)
+			:ringBytes(ringBytes) {
+			spillFd = ::open(spillPath.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+			if (spillFd < 0)
+				throw std::system_error(errno, std::generic_category(), "cannot open " + spillPath);
+			struct stat st;
+			if (::fstat(spillFd, &st) == 0 && st.st_size == 0 && !details::writeAll(spillFd, details::logMagic, sizeof(details::logMagic))) {
+				int error = errno;
+				::close(spillFd);
+				throw std::system_error(error, std::generic_category(), "cannot write " + spillPath);
+			}
+			start();
+		}
+
+		Logger(const Logger&) = delete;
+		Logger& operator=(const Logger&) = delete;
+
+		//Writes everything logged so far, then stops the background thread.
+		~Logger() {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stopping = true;
+			}
+			wake.notify_one();
+			worker.join();
+			if (spillFd >= 0)
+				::close(spillFd);
+		}
+
+		//Captures the event; arguments are integers, floating point, bools, enums or strings.
+		template<typename... Args>
+		bool log(const LogEvent& event, const Args&... args) {
+			details::LogRing& ring = localRing();
+			size_t size = details::logHeader + (details::logSize(args) + ... + 0);
+			char* at = ring.reserve(size);
+			if (!at) {
+				ring.dropped.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+			int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+			details::putRaw(at, static_cast<uint32_t>(size));
+			details::putRaw(at, event.id());
+			details::putRaw(at, now);
+			(details::logPut(at, args), ...);
+			ring.commit();
+			return true;
+		}
+
+		//Blocks until everything logged before the call has been written out; throws
+		//once a write has failed.
+		void flush() {
+			std::unique_lock<std::mutex> lock(mutex);
+			unsigned long long target = ++requested;
+			wake.notify_one();
+			served.wait(lock, [this, target]() { return completed >= target; });
+			if (int failure = error.load())
+				throw std::system_error(failure, std::generic_category(), "Logger write failed");
+		}
+
+		unsigned long long dropped() {
+			unsigned long long total = 0;
+			std::lock_guard<std::mutex> lock(ringsMutex);
+			for (auto& ring : rings)
+				total += ring->dropped.load(std::memory_order_relaxed);
+			return total;
+		}
+
+		//Records taken from the rings but lost to a failed write.
+		unsigned long long failed() const {
+			return lost.load(std::memory_order_relaxed);
+		}
+	};
+
+	//Converts a binary spill file written by Logger into NDJSON.
+	inline void decodeLog(const std::string& spillPath, std::ostream& ndjson) {
+		std::ifstream in(spillPath, std::ios::binary);
+		char magic[sizeof(details::logMagic)];
+		if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, details::logMagic, sizeof(magic)) != 0)
+			throw std::runtime_error(spillPath + " is not a JsonWriter log");
+
+		std::unordered_map<uint32_t, details::LogDefinition> events;
+		std::string record;
+		char header[8];
+		while (in.read(header, sizeof(header))) {
+			const char* at = header;
+			uint32_t size = details::getRaw<uint32_t>(at);
+			uint32_t id = details::getRaw<uint32_t>(at);
+			if (size < sizeof(header))
+				throw std::runtime_error(spillPath + ": corrupt record");
+			record.assign(header, sizeof(header));
+			record.resize(size);
+			if (!in.read(&record[sizeof(header)], static_cast<std::streamsize>(size - sizeof(header))))
+				throw std::runtime_error(spillPath + ": truncated record");
+
+			const char* end = record.data() + record.size();
+			at = record.data() + sizeof(header);
+			if (id == details::logDefinition) {
+				details::LogDefinition event;
+				if (end - at < 4)
+					throw std::runtime_error(spillPath + ": corrupt definition");
+				uint32_t defined = details::getRaw<uint32_t>(at);
+				bool ok = details::readString(at, end, event.name) && end - at >= 4;
+				uint32_t count = ok ? details::getRaw<uint32_t>(at) : 0;
+				for (uint32_t i = 0; ok && i < count; ++i) {
+					event.fields.emplace_back();
+					ok = details::readString(at, end, event.fields.back());
+				}
+				if (!ok)
+					throw std::runtime_error(spillPath + ": corrupt definition");
+				events[defined] = std::move(event);
+				continue;
+			}
+			auto known = events.find(id);
+			if (!details::formatLogRecord(ndjson, record.data(), record.size(), known == events.end() ? nullptr : &known->second, id))
+				throw std::runtime_error(spillPath + ": corrupt record");
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,399 @@
+#ifndef JsonSinkH
+#define JsonSinkH
+#include "JsonWriter.h"
+#include <streambuf>
+#include <system_error>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+//POSIX sinks: serialize into a std::ostream backed by one of these buffers
+//and hand the result to a file descriptor without extra copies.
+namespace Json
+{
+	namespace details
+	{
+		inline bool writeAll(int fd, const char* data, size_t size) noexcept {
+			while (size > 0) {
+				ssize_t written = ::write(fd, data, size);
+				if (written < 0) {
+					if (errno == EINTR)
+						continue;
+					return false;
+				}
+				data += written;
+				size -= static_cast<size_t>(written);
+			}
+			return true;
+		}
+
+		inline bool preadAll(int fd, char* data, size_t size, off_t offset) noexcept {
+			while (size > 0) {
+				ssize_t got = ::pread(fd, data, size, offset);
+				if (got < 0) {
+					if (errno == EINTR)
+						continue;
+					return false;
+				}
+				if (got == 0) {
+					errno = EIO;
+					return false;
+				}
+				data += got;
+				size -= static_cast<size_t>(got);
+				offset += got;
+			}
+			return true;
+		}
+
+		inline bool pwriteAll(int fd, const char* data, size_t size, off_t offset) noexcept {
+			while (size > 0) {
+				ssize_t written = ::pwrite(fd, data, size, offset);
+				if (written < 0) {
+					if (errno == EINTR)
+						continue;
+					return false;
+				}
+				data += written;
+				size -= static_cast<size_t>(written);
+				offset += written;
+			}
+			return true;
+		}
+
+		//Copies [offset, offset + size) of inFd to outFd, in kernel when possible.
+		inline bool sendAll(int outFd, int inFd, off_t offset, size_t size) noexcept {
+			while (size > 0) {
+				ssize_t sent = ::sendfile(outFd, inFd, &offset, size);
+				if (sent < 0) {
+					if (errno == EINTR)
+						continue;
+					if (errno != EINVAL && errno != ENOSYS)
+						return false;
+
+					char chunk[1 << 16];
+					while (size > 0) {
+						size_t step = size < sizeof(chunk) ? size : sizeof(chunk);
+						if (!preadAll(inFd, chunk, step, offset) || !writeAll(outFd, chunk, step))
+							return false;
+						offset += static_cast<off_t>(step);
+						size -= step;
+					}
+					return true;
+				}
+				if (sent == 0) {
+					errno = EIO;
+					return false;
+				}
+				size -= static_cast<size_t>(sent);
+			}
+			return true;
+		}
+
+		//Like sendAll, but lets the filesystem share extents when outFd is a regular file.
+		inline bool copyRange(int outFd, int inFd, off_t offset, size_t size) noexcept {
+			struct stat st;
+			if (::fstat(outFd, &st) == 0 && S_ISREG(st.st_mode)) {
+				while (size > 0) {
+					ssize_t copied = ::copy_file_range(inFd, &offset, outFd, nullptr, size, 0);
+					if (copied < 0) {
+						if (errno == EINTR)
+							continue;
+						if (errno == EXDEV || errno == EINVAL || errno == ENOSYS || errno == EOPNOTSUPP)
+							break;
+						return false;
+					}
+					if (copied == 0) {
+						errno = EIO;
+						return false;
+					}
+					size -= static_cast<size_t>(copied);
+				}
+			}
+			return sendAll(outFd, inFd, offset, size);
+		}
+
+		//Anonymous file in dir; O_TMPFILE where supported, mkstemp + unlink otherwise.
+		inline int openTempFile(const std::string& dir) {
+#ifdef O_TMPFILE
+			int fd = ::open(dir.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+			if (fd >= 0)
+				return fd;
+#endif
+			std::string path = dir + "/JsonWriterXXXXXX";
+			int fallback = ::mkstemp(&path[0]);
+			if (fallback < 0)
+				throw std::system_error(errno, std::generic_category(), "cannot create temporary file in " + dir);
+			::unlink(path.c_str());
+			return fallback;
+		}
+	}
+
+	//Stream buffer backed by a file descriptor. FileFragment nodes written into
+	//a Sink are moved in kernel instead of being read through user space.
+	class Sink : public std::streambuf {
+	public:
+		//Outcome of transferFrom. Unsupported leaves the output untouched and the caller
+		//copies the range itself; after Failed part of it may have been written, so the
+		//stream is broken rather than retried.
+		enum class Transfer {
+			Unsupported,
+			Done,
+			Failed
+		};
+
+		//Appends [offset, offset + size) of fd.
+		virtual Transfer transferFrom(int fd, off_t offset, size_t size) {
+			(void)fd;
+			(void)offset;
+			(void)size;
+			return Transfer::Unsupported;
+		}
+	};
+
+	//Buffered sink writing to a descriptor it does not own.
+	class FdSink : public Sink {
+	private:
+		int fd;
+		std::vector<char> buffer;
+
+		bool flushBuffer() {
+			size_t bytes = static_cast<size_t>(pptr() - pbase());
+			JSON_WRITER_PROBE2(sink__flush, fd, bytes);
+			if (!details::writeAll(fd, pbase(), bytes))
+				return false;
+			setp(buffer.data(), buffer.data() + buffer.size());
+			return true;
+		}
+	protected:
+		virtual int_type overflow(int_type ch) override {
+			if (!flushBuffer())
+				return traits_type::eof();
+			if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+				*pptr() = traits_type::to_char_type(ch);
+				pbump(1);
+			}
+			return traits_type::not_eof(ch);
+		}
+
+		virtual std::streamsize xsputn(const char* data, std::streamsize count) override {
+			if (static_cast<size_t>(count) >= buffer.size()) {
+				if (!flushBuffer())
+					return 0;
+				JSON_WRITER_PROBE2(sink__flush, fd, count);
+				if (!details::writeAll(fd, data, static_cast<size_t>(count)))
+					return 0;
+				return count;
+			}
+			return std::streambuf::xsputn(data, count);
+		}
+
+		virtual int sync() override {
+			return flushBuffer() ? 0 : -1;
+		}
+	public:
+		explicit FdSink(int fd, size_t bufferSize = 1 << 16)
+			:fd(fd), buffer(bufferSize < 64 ? 64 : bufferSize) {
+			setp(buffer.data(), buffer.data() + buffer.size());
+		}
+
+		FdSink(const FdSink&) = delete;
+		FdSink& operator=(const FdSink&) = delete;
+
+		virtual ~FdSink() {
+			sync();
+		}
+
+		virtual Transfer transferFrom(int inFd, off_t offset, size_t size) override {
+			return flushBuffer() && details::copyRange(fd, inFd, offset, size) ? Transfer::Done : Transfer::Failed;
+		}
+	};
+
+	//Buffers output in memory up to threshold bytes, then continues in an
+	//unlinked temporary file. Memory use never exceeds threshold.
+	class SpillSink : public Sink {
+	private:
+		std::vector<char> memory;
+		size_t threshold;
+		std::string tempDir;
+		int fd = -1;
+		size_t spilledBytes = 0;
+
+		size_t pending() const {
+			return static_cast<size_t>(pptr() - pbase());
+		}
+
+		void resetPut(size_t used) {
+			setp(memory.data(), memory.data() + memory.size());
+			while (used > INT_MAX) {
+				pbump(INT_MAX);
+				used -= INT_MAX;
+			}
+			pbump(static_cast<int>(used));
+		}
+
+		bool flushPending() {
+			JSON_WRITER_PROBE2(sink__flush, fd, pending());
+			if (!details::writeAll(fd, pbase(), pending()))
+				return false;
+			spilledBytes += pending();
+			resetPut(0);
+			return true;
+		}
+
+		void spill() {
+			fd = details::openTempFile(tempDir);
+			spilledBytes = 0;
+			JSON_WRITER_PROBE2(sink__spill, fd, pending());
+		}
+	protected:
+		virtual int_type overflow(int_type ch) override {
+			if (fd < 0 && memory.size() < threshold) {
+				size_t used = pending();
+				size_t grown = memory.size() * 2;
+				if (grown < 4096)
+					grown = 4096;
+				if (grown > threshold)
+					grown = threshold;
+				JSON_WRITER_PROBE2(buffer__grow, memory.size(), grown);
+				memory.resize(grown);
+				resetPut(used);
+			}
+			else {
+				if (fd < 0) {
+					try {
+						spill();
+					}
+					catch (const std::system_error&) {
+						return traits_type::eof();
+					}
+				}
+				if (!flushPending())
+					return traits_type::eof();
+			}
+
+			if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+				*pptr() = traits_type::to_char_type(ch);
+				pbump(1);
+			}
+			return traits_type::not_eof(ch);
+		}
+
+		virtual std::streamsize xsputn(const char* data, std::streamsize count) override {
+			if (fd >= 0 && static_cast<size_t>(count) >= memory.size()) {
+				if (!flushPending() || !details::writeAll(fd, data, static_cast<size_t>(count)))
+					return 0;
+				spilledBytes += static_cast<size_t>(count);
+				return count;
+			}
+			return std::streambuf::xsputn(data, count);
+		}
+
+		virtual int sync() override {
+			if (fd >= 0 && !flushPending())
+				return -1;
+			return 0;
+		}
+	public:
+		explicit SpillSink(size_t threshold = 1 << 20, std::string tempDir = "/tmp")
+			:threshold(threshold < 4096 ? 4096 : threshold), tempDir(std::move(tempDir)) {}
+
+		SpillSink(const SpillSink&) = delete;
+		SpillSink& operator=(const SpillSink&) = delete;
+
+		virtual ~SpillSink() {
+			if (fd >= 0)
+				::close(fd);
+		}
+
+		bool spilled() const {
+			return fd >= 0;
+		}
+
+		size_t size() const {
+			return spilledBytes + pending();
+		}
+
+		virtual Transfer transferFrom(int inFd, off_t offset, size_t length) override {
+			if (fd < 0) {
+				if (size() + length <= threshold)
+					return Transfer::Unsupported;
+				try {
+					spill();
+				}
+				catch (const std::system_error&) {
+					return Transfer::Unsupported;
+				}
+			}
+			if (!flushPending() || !details::copyRange(fd, inFd, offset, length))
+				return Transfer::Failed;
+			spilledBytes += length;
+			return Transfer::Done;
+		}
+
+		//Writes everything buffered so far to outFd; spilled data goes through sendfile.
+		void replay(int outFd) {
+			bool ok;
+			if (fd < 0)
+				ok = details::writeAll(outFd, pbase(), pending());
+			else
+				ok = sync() == 0 && details::sendAll(outFd, fd, 0, spilledBytes);
+			if (!ok)
+				throw std::system_error(errno, std::generic_category(), "SpillSink replay failed");
+		}
+
+		//Drops the content, keeping the memory buffer for the next document.
+		void clear() {
+			if (fd >= 0) {
+				::close(fd);
+				fd = -1;
+			}
+			spilledBytes = 0;
+			resetPut(0);
+		}
+	};
+
+	//Pre-rendered JSON stored in [offset, offset + length) of fd, spliced in
+	//verbatim. The descriptor is not owned and must outlive serialization.
+	class FileFragment : public Node {
+	private:
+		int fd;
+		off_t offset;
+		size_t length;
+
+		virtual std::ostream& write(std::ostream& os) const noexcept override {
+			if (Sink* sink = dynamic_cast<Sink*>(os.rdbuf())) {
+				Sink::Transfer result = sink->transferFrom(fd, offset, length);
+				if (result == Sink::Transfer::Failed)
+					os.setstate(std::ios_base::badbit);
+				if (result != Sink::Transfer::Unsupported)
+					return os;
+			}
+
+			char chunk[1 << 14];
+			off_t position = offset;
+			size_t left = length;
+			while (left > 0 && os) {
+				size_t step = left < sizeof(chunk) ? left : sizeof(chunk);
+				if (!details::preadAll(fd, chunk, step, position)) {
+					os.setstate(std::ios_base::badbit);
+					break;
+				}
+				os.write(chunk, static_cast<std::streamsize>(step));
+				position += static_cast<off_t>(step);
+				left -= step;
+			}
+			return os;
+		}
+	public:
+		FileFragment(int fd, off_t offset, size_t length)
+			:fd(fd), offset(offset), length(length) {}
+	};
+}
+
+#endif
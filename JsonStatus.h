@@ -0,0 +1,213 @@
+#ifndef JsonStatusH
+#define JsonStatusH
+#include "JsonFile.h"
+#include <sys/mman.h>
+
+//Status files that pollers read while the process keeps updating them: the document is
+//written once, then each counter is overwritten in place in the mapped file.
+//  Json::StatusFile status("/run/ingest/status.json");
+//  Json::Slot requests = status.slot();
+//  status.publish(Json::Object()("service", "ingest")("requests", requests));
+//  status.set(requests, 1234);
+namespace Json
+{
+	class StatusFile;
+
+	namespace details
+	{
+		//Bytes reserved for a slot: a 64-bit integer (at most 20 characters) padded with
+		//spaces to whole 8-byte words.
+		const size_t slotWidth = 24;
+
+		//Where a slot sits in the published text, npos while it is not in it, and its value.
+		struct SlotPlace {
+			size_t offset;
+			long long value;
+		};
+	}
+
+	//Integer counter of a StatusFile. In a document published to its file it becomes a
+	//fixed-width, space-padded field that set() rewrites in place; written anywhere else
+	//it is just its initial value.
+	class Slot : public Node {
+	private:
+		const StatusFile* owner;
+		size_t id;
+		long long initial;
+
+		friend class StatusFile;
+
+		Slot(const StatusFile* owner, size_t id, long long initial)
+			:owner(owner), id(id), initial(initial) {}
+
+		virtual std::ostream& write(std::ostream& os) const noexcept override;
+
+		virtual void writeBson(std::string& out, std::string_view key) const override {
+			details::bsonScalar(out, key, initial);
+		}
+	};
+
+	namespace details
+	{
+		//Rewrites a slot holding before so it holds after, one aligned word per store(word, bits).
+		//The slot is digits then spaces and starts on a word boundary, so a partly written
+		//slot splits the digits at least 8 characters in. Growing, left to right, the new
+		//digits written so far run into old digits or old spaces; shrinking, right to left,
+		//the old digits left in front run into new digits or new spaces. Both read as one number.
+		template<typename Store>
+		inline void updateSlot(char* slot, long long before, long long after, Store&& store) {
+			const size_t words = slotWidth / 8;
+			char text[slotWidth];
+			size_t shorter = static_cast<size_t>(std::to_chars(text, text + sizeof(text), before).ptr - text);
+			std::memset(text, ' ', sizeof(text));
+			bool longer = static_cast<size_t>(std::to_chars(text, text + sizeof(text), after).ptr - text) >= shorter;
+			uint64_t next[words];
+			std::memcpy(next, text, sizeof(text));
+			uint64_t* at = reinterpret_cast<uint64_t*>(slot);
+			for (size_t i = 0; i < words; ++i) {
+				size_t word = longer ? i : words - 1 - i;
+				if (at[word] != next[word])
+					store(at + word, next[word]);
+			}
+		}
+
+		//Stream buffer collecting a published document and the offset of every slot in it.
+		//A slot starts on an 8-byte boundary, so its words are its own: updates never touch
+		//the bytes around it and slots of different threads never share a word.
+		class SlotBuffer : public StringBuffer {
+		private:
+			std::string& out;
+			const StatusFile* owner;
+			std::vector<SlotPlace>& places;
+			bool repeated = false;
+		public:
+			SlotBuffer(std::string& out, const StatusFile* owner, std::vector<SlotPlace>& places)
+				:StringBuffer(out), out(out), owner(owner), places(places) {}
+
+			//Writes the slot padded to its words; false when it belongs to another file.
+			bool place(const StatusFile* file, size_t id) noexcept {
+				if (file != owner || id >= places.size())
+					return false;
+				SlotPlace& place = places[id];
+				if (place.offset != std::string::npos)
+					repeated = true;
+				out.append((8 - out.size() % 8) % 8, ' ');
+				place.offset = out.size();
+				out.append(slotWidth, ' ');
+				std::to_chars(&out[place.offset], &out[place.offset] + slotWidth, place.value);
+				return true;
+			}
+
+			bool reused() const {
+				return repeated;
+			}
+		};
+	}
+
+	//JSON document in a file that pollers can read at any time. publish() writes the
+	//document to a temporary file, maps it and renames it over the path; set() then
+	//stores a slot's new digits into the mapping one aligned word at a time, ordered so
+	//that every intermediate state is still a valid number: left to right when the
+	//number gets longer, right to left when it gets shorter. A reader racing an update
+	//may see a mix of the old and new digits, never a broken document.
+	//Slots of different threads can be set concurrently; each slot has a single writer,
+	//and publish() must not run alongside set().
+	class StatusFile {
+	private:
+		std::string path;
+		std::vector<details::SlotPlace> places;
+		char* mapping = nullptr;
+		size_t mapped = 0;
+
+		bool owns(const Slot& slot) const {
+			return slot.owner == this && slot.id < places.size();
+		}
+	public:
+		explicit StatusFile(std::string path)
+			:path(std::move(path)) {}
+
+		StatusFile(const StatusFile&) = delete;
+		StatusFile& operator=(const StatusFile&) = delete;
+
+		~StatusFile() {
+			if (mapping)
+				::munmap(mapping, mapped);
+		}
+
+		Slot slot(long long initial = 0) {
+			places.push_back(details::SlotPlace{ std::string::npos, initial });
+			return Slot(this, places.size() - 1, initial);
+		}
+
+		//Replaces the file with document, whose slots of this file are written with their
+		//current values. Readers see either the previous document or this one.
+		void publish(const Node& document) {
+			std::vector<details::SlotPlace> placed = places;
+			for (details::SlotPlace& place : placed)
+				place.offset = std::string::npos;
+			std::string text;
+			details::SlotBuffer buffer(text, this, placed);
+			std::ostream os(&buffer);
+			os << document << '\n';
+			if (buffer.reused())
+				throw std::invalid_argument("StatusFile: a slot appears twice in the document");
+
+			std::string temporary = path + ".tmp";
+			int fd = ::open(temporary.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+			if (fd < 0)
+				throw std::system_error(errno, std::generic_category(), "cannot open " + temporary);
+			void* address = MAP_FAILED;
+			if (!details::pwriteAll(fd, text.data(), text.size(), 0) || ::fdatasync(fd) != 0
+				|| (address = ::mmap(nullptr, text.size(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED
+				|| ::rename(temporary.c_str(), path.c_str()) != 0) {
+				int error = errno;
+				if (address != MAP_FAILED)
+					::munmap(address, text.size());
+				::close(fd);
+				::unlink(temporary.c_str());
+				throw std::system_error(error, std::generic_category(), "cannot publish " + path);
+			}
+			::close(fd);
+
+			if (mapping)
+				::munmap(mapping, mapped);
+			mapping = static_cast<char*>(address);
+			mapped = text.size();
+			places.swap(placed);
+		}
+
+		void set(const Slot& slot, long long value) {
+			if (!owns(slot))
+				throw std::invalid_argument("StatusFile: slot of another file");
+			details::SlotPlace& place = places[slot.id];
+			long long before = place.value;
+			place.value = value;
+			if (!mapping || place.offset == std::string::npos)
+				return;
+			details::updateSlot(mapping + place.offset, before, value, [](uint64_t* word, uint64_t bits) {
+				__atomic_store_n(word, bits, __ATOMIC_RELEASE);
+			});
+		}
+
+		long long get(const Slot& slot) const {
+			if (!owns(slot))
+				throw std::invalid_argument("StatusFile: slot of another file");
+			return places[slot.id].value;
+		}
+
+		//Waits until the updates made so far are on stable storage.
+		void sync() {
+			if (mapping && ::msync(mapping, mapped, MS_SYNC) != 0)
+				throw std::system_error(errno, std::generic_category(), "StatusFile sync failed");
+		}
+	};
+
+	inline std::ostream& Slot::write(std::ostream& os) const noexcept {
+		auto* buffer = dynamic_cast<details::SlotBuffer*>(os.rdbuf());
+		if (buffer && buffer->place(owner, id))
+			return os;
+		return details::writeInteger(os, initial);
+	}
+}
+
+#endif
@@ -0,0 +1,35 @@
+//Compiled part of JsonWriter (CMake target JsonWriter::compiled): the out-of-line
+//kernels and the instantiations declared extern in JsonWriter.h.
+#ifndef JSON_WRITER_COMPILED
+#define JSON_WRITER_COMPILED
+#endif
+#define JSON_WRITER_SOURCE
+#include "JsonWriter.h"
+
+namespace Json
+{
+	template class Value<int>;
+	template class Value<unsigned>;
+	template class Value<long long>;
+	template class Value<double>;
+	template class Value<bool>;
+	template class Value<std::string>;
+	template class Array<int>;
+	template class Array<long long>;
+	template class Array<double>;
+	template class Array<std::string>;
+	template class Array<Object>;
+	template std::shared_ptr<Node> Node::create<int>(int&&);
+	template std::shared_ptr<Node> Node::create<int&>(int&);
+	template std::shared_ptr<Node> Node::create<double>(double&&);
+	template std::shared_ptr<Node> Node::create<double&>(double&);
+	template std::shared_ptr<Node> Node::create<bool>(bool&&);
+	template std::shared_ptr<Node> Node::create<std::string>(std::string&&);
+	template std::shared_ptr<Node> Node::create<std::string&>(std::string&);
+	template std::shared_ptr<Node> Node::create<const std::string&>(const std::string&);
+	template std::shared_ptr<Node> Node::create<Object>(Object&&);
+	template std::shared_ptr<Node> Node::create<int>(std::initializer_list<int>);
+	template std::shared_ptr<Node> Node::create<double>(std::initializer_list<double>);
+	template std::shared_ptr<Node> Node::create<const char*>(std::initializer_list<const char*>);
+	template std::shared_ptr<Node> Node::create<Object>(std::initializer_list<Object>);
+}
@@ -2,7 +2,71 @@
 #define JsonWriterH
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include <memory>
+#include <string>
+#include <ostream>
+#include <sstream>
+#include <iomanip>
+#include <locale>
+#include <ctime>
+#include <chrono>
+#include <type_traits>
+#include <typeinfo>
+#include <tuple>
+#include <utility>
+#include <stdexcept>
+#include <charconv>
+#include <cstdint>
+#include <iterator>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <string_view>
+#include <algorithm>
+#include <cstring>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#define JSON_WRITER_SSE2
+#endif
+
+//With JSON_WRITER_COMPILED the kernels marked JSON_WRITER_INLINE and the common
+//instantiations declared at the end of this file are compiled once, in JsonWriter.cpp
+//(CMake target JsonWriter::compiled), instead of in every translation unit.
+//The two modes define the same kernels with different linkage, so every translation
+//unit of a program must use the same one: linking JsonWriter::compiled together with
+//code built header-only breaks the one-definition rule.
+#if defined(JSON_WRITER_COMPILED) && !defined(JSON_WRITER_SOURCE)
+#define JSON_WRITER_EXTERNAL
+#endif
+#ifdef JSON_WRITER_COMPILED
+#define JSON_WRITER_INLINE
+#else
+#define JSON_WRITER_INLINE inline
+#endif
+
+//USDT probes, provider "jsonwriter", compiled in with JSON_WRITER_USDT where <sys/sdt.h>
+//exists and expanding to nothing otherwise. A disabled probe site is a single nop:
+//  bpftrace -e 'usdt:./app:jsonwriter:document__begin { @t[tid] = nsecs; }
+//    usdt:./app:jsonwriter:document__end /@t[tid]/ { @ns = hist(nsecs - @t[tid]); delete(@t[tid]); }'
+//document__begin(node, streambuf), document__end(node, streambuf, failed),
+//sink__flush(fd, bytes), sink__spill(fd, bytes), buffer__grow(from, to),
+//escape(length, escaped characters).
+#if defined(JSON_WRITER_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define JSON_WRITER_PROBE2(name, a, b) DTRACE_PROBE2(jsonwriter, name, a, b)
+#define JSON_WRITER_PROBE3(name, a, b, c) DTRACE_PROBE3(jsonwriter, name, a, b, c)
+#endif
+#endif
+#ifndef JSON_WRITER_PROBE2
+#define JSON_WRITER_PROBE2(name, a, b) do { (void)sizeof(a); (void)sizeof(b); } while (0)
+#define JSON_WRITER_PROBE3(name, a, b, c) do { (void)sizeof(a); (void)sizeof(b); (void)sizeof(c); } while (0)
+#endif
 
 namespace Json
 {
@@ -14,162 +78,2596 @@ namespace Json
 			charT do_decimal_point() const { return sep; }
 		};
 
-		typedef punct_facet<char, '.'> DecimalPointFacet;
-	}
+		typedef punct_facet<char, '.'> DecimalPointFacet;
+
+		constexpr bool needsEscape(char ch) {
+			return ch == '\"' || ch == '\\' || ch == '/';
+		}
+
+#ifdef JSON_WRITER_EXTERNAL
+		void appendEscaped(std::string& out, const char* data, size_t size);
+#else
+		JSON_WRITER_INLINE void appendEscaped(std::string& out, const char* data, size_t size) {
+			size_t start = out.size();
+			out += '\"';
+			size_t run = 0;
+			for (size_t i = 0; i < size; ++i) {
+				char ch = data[i];
+				if (needsEscape(ch)) {
+					out.append(data + run, i - run);
+					out += '\\';
+					run = i;
+				}
+			}
+			out.append(data + run, size - run);
+			out += '\"';
+			if (out.size() - start != size + 2)
+				JSON_WRITER_PROBE2(escape, size, out.size() - start - size - 2);
+		}
+#endif
+
+		//appendEscaped straight into a stream, for writers that keep no buffer of their own.
+		inline std::ostream& writeEscaped(std::ostream& os, const char* data, size_t size) noexcept {
+			os.put('\"');
+			size_t run = 0;
+			for (size_t i = 0; i < size; ++i) {
+				if (needsEscape(data[i])) {
+					os.write(data + run, static_cast<std::streamsize>(i - run));
+					os.put('\\');
+					run = i;
+				}
+			}
+			os.write(data + run, static_cast<std::streamsize>(size - run));
+			return os.put('\"');
+		}
+
+#ifdef JSON_WRITER_SSE2
+		//Index of the lowest set bit of a non-zero movemask.
+		inline size_t lowestBit(int mask) noexcept {
+#ifdef _MSC_VER
+			unsigned long bit;
+			_BitScanForward(&bit, static_cast<unsigned long>(mask));
+			return bit;
+#else
+			return static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+#endif
+		}
+#endif
+
+		//Position of the first byte in [from, size) that is a quote or whitespace/control
+		//character (<= 0x20), or size.
+		inline size_t findQuoteOrSpace(const char* data, size_t from, size_t size) noexcept {
+#ifdef JSON_WRITER_SSE2
+			const __m128i quote = _mm_set1_epi8('\"');
+			const __m128i space = _mm_set1_epi8(0x20);
+			for (; from + 16 <= size; from += 16) {
+				__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + from));
+				__m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(_mm_min_epu8(chunk, space), chunk));
+				int mask = _mm_movemask_epi8(hits);
+				if (mask)
+					return from + lowestBit(mask);
+			}
+#endif
+			for (; from < size; ++from)
+				if (data[from] == '\"' || static_cast<unsigned char>(data[from]) <= 0x20)
+					return from;
+			return size;
+		}
+
+		//Position of the first quote or backslash in [from, size), or size.
+		inline size_t findQuoteOrBackslash(const char* data, size_t from, size_t size) noexcept {
+#ifdef JSON_WRITER_SSE2
+			const __m128i quote = _mm_set1_epi8('\"');
+			const __m128i backslash = _mm_set1_epi8('\\');
+			for (; from + 16 <= size; from += 16) {
+				__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + from));
+				int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)));
+				if (mask)
+					return from + lowestBit(mask);
+			}
+#endif
+			for (; from < size; ++from)
+				if (data[from] == '\"' || data[from] == '\\')
+					return from;
+			return size;
+		}
+
+		//Appends JSON text to out without the whitespace between tokens; strings are kept as they are.
+#ifdef JSON_WRITER_EXTERNAL
+		void appendMinified(std::string& out, const char* data, size_t size);
+#else
+		JSON_WRITER_INLINE void appendMinified(std::string& out, const char* data, size_t size) {
+			size_t run = 0;
+			size_t at = 0;
+			while (at < size) {
+				at = findQuoteOrSpace(data, at, size);
+				if (at >= size)
+					break;
+				if (data[at] == '\"') {
+					for (at = findQuoteOrBackslash(data, at + 1, size); at < size && data[at] == '\\';)
+						at = findQuoteOrBackslash(data, at + 2, size);
+					++at;
+					continue;
+				}
+				out.append(data + run, at - run);
+				while (at < size && static_cast<unsigned char>(data[at]) <= 0x20)
+					++at;
+				run = at;
+			}
+			if (run < size)
+				out.append(data + run, size - run);
+		}
+#endif
+
+		template<typename T>
+		inline void appendNumber(std::string& out, T value, int precision) {
+			char buffer[64];
+			std::to_chars_result result;
+			if constexpr (std::is_floating_point<T>::value)
+				result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::general, precision);
+			else
+				result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+			out.append(buffer, result.ptr);
+		}
+	}
+
+	//Names an enum value in JSON output.
+	template<typename E>
+	struct EnumName {
+		E value;
+		const char* name;
+	};
+
+	//Specialize to serialize an enum by name instead of by number:
+	//template<> struct Json::EnumNames<Color> {
+	//	static constexpr Json::EnumName<Color> entries[] = { { Color::Red, "red" }, { Color::Blue, "blue" } };
+	//};
+	template<typename E>
+	struct EnumNames;
+
+	namespace details
+	{
+		template<typename E, typename = void>
+		struct HasEnumNames : std::false_type {};
+
+		template<typename E>
+		struct HasEnumNames<E, std::void_t<decltype(EnumNames<E>::entries)>> : std::true_type {};
+
+		//All names of E quoted and escaped back to back; token i is text[offsets[i], offsets[i + 1]).
+		template<size_t Count, size_t Size>
+		struct EnumTable {
+			char text[Size];
+			uint32_t offsets[Count + 1];
+			long long first;
+			bool dense;
+		};
+
+		template<typename E>
+		constexpr size_t enumTextSize() {
+			size_t size = 0;
+			for (const auto& entry : EnumNames<E>::entries) {
+				size += 2;
+				for (const char* ch = entry.name; *ch; ++ch)
+					size += needsEscape(*ch) ? 2 : 1;
+			}
+			return size;
+		}
+
+		template<typename E>
+		constexpr auto makeEnumTable() {
+			constexpr size_t count = std::size(EnumNames<E>::entries);
+			EnumTable<count, enumTextSize<E>()> table{};
+			table.first = static_cast<long long>(EnumNames<E>::entries[0].value);
+			table.dense = true;
+
+			size_t size = 0;
+			for (size_t i = 0; i < count; ++i) {
+				const auto& entry = EnumNames<E>::entries[i];
+				table.dense = table.dense && static_cast<long long>(entry.value) == table.first + static_cast<long long>(i);
+				table.offsets[i] = static_cast<uint32_t>(size);
+				table.text[size++] = '\"';
+				for (const char* ch = entry.name; *ch; ++ch) {
+					if (needsEscape(*ch))
+						table.text[size++] = '\\';
+					table.text[size++] = *ch;
+				}
+				table.text[size++] = '\"';
+			}
+			table.offsets[count] = static_cast<uint32_t>(size);
+			return table;
+		}
+
+		template<typename E>
+		inline constexpr auto enumTable = makeEnumTable<E>();
+
+		//Position of value in EnumNames<E>::entries, the entry count when it has no name.
+		template<typename E>
+		inline size_t enumIndex(E value) noexcept {
+			constexpr auto& table = enumTable<E>;
+			constexpr size_t count = std::size(EnumNames<E>::entries);
+			if (table.dense) {
+				unsigned long long offset = static_cast<unsigned long long>(static_cast<long long>(value) - table.first);
+				return offset < count ? static_cast<size_t>(offset) : count;
+			}
+			for (size_t i = 0; i < count; ++i)
+				if (EnumNames<E>::entries[i].value == value)
+					return i;
+			return count;
+		}
+
+		//Quoted name of value, or nullptr when E has no name for it.
+		template<typename E>
+		inline const char* enumToken(E value, size_t& size) noexcept {
+			constexpr auto& table = enumTable<E>;
+			size_t index = enumIndex(value);
+			if (index == std::size(EnumNames<E>::entries))
+				return nullptr;
+			size = table.offsets[index + 1] - table.offsets[index];
+			return table.text + table.offsets[index];
+		}
+	}
+
+	//How time points and durations are written: calendar strings (UTC) or a
+	//number of units since the clock's epoch / in the duration.
+	enum class TimeEncoding {
+		Iso,		//"2024-05-01T12:30:00", time points only
+		Rfc3339,	//"2024-05-01T12:30:00.250Z", fraction at the clock's precision
+		Seconds,
+		Millis,
+		Micros,
+		Nanos
+	};
+
+	//Time point or duration with an explicit encoding. Without it time points
+	//are written as Rfc3339 and durations as their count().
+	template<typename T>
+	struct Time {
+		T value;
+		TimeEncoding encoding;
+
+		Time(const T& value, TimeEncoding encoding)
+			:value(value), encoding(encoding) {}
+	};
+
+	namespace details
+	{
+		template<typename T>
+		struct IsFastInteger : std::integral_constant<bool, std::is_integral<T>::value
+			&& !std::is_same<T, bool>::value && !std::is_same<T, char>::value && !std::is_same<T, signed char>::value
+			&& !std::is_same<T, unsigned char>::value && !std::is_same<T, wchar_t>::value
+			&& !std::is_same<T, char16_t>::value && !std::is_same<T, char32_t>::value> {};
+
+		template<typename T>
+		inline std::ostream& writeInteger(std::ostream& os, T value) noexcept {
+			char buffer[24];
+			auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+			return os.write(buffer, result.ptr - buffer);
+		}
+
+		inline char* writeDigits(char* out, unsigned long long value, int width) noexcept {
+			for (int i = width - 1; i >= 0; --i) {
+				out[i] = static_cast<char>('0' + value % 10);
+				value /= 10;
+			}
+			return out + width;
+		}
+
+		//Proleptic Gregorian date of a day count since 1970-01-01.
+		inline void civilFromDays(long long days, long long& year, unsigned& month, unsigned& day) noexcept {
+			days += 719468;
+			long long era = (days >= 0 ? days : days - 146096) / 146097;
+			unsigned dayOfEra = static_cast<unsigned>(days - era * 146097);
+			unsigned yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+			unsigned dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+			unsigned shifted = (5 * dayOfYear + 2) / 153;
+			day = dayOfYear - (153 * shifted + 2) / 5 + 1;
+			month = shifted < 10 ? shifted + 3 : shifted - 9;
+			year = static_cast<long long>(yearOfEra) + era * 400 + (month <= 2);
+		}
+
+		template<typename Period>
+		constexpr int fractionDigits() {
+			int digits = 0;
+			for (std::intmax_t scale = 1; scale < Period::den && digits < 9; scale *= 10)
+				++digits;
+			return Period::num == 1 ? digits : 9;
+		}
+
+		template<typename Duration>
+		inline std::ostream& writeCalendar(std::ostream& os, Duration sinceEpoch, bool fraction) noexcept {
+			using namespace std::chrono;
+			auto seconds = floor<std::chrono::seconds>(sinceEpoch);
+			long long total = seconds.count();
+			long long days = (total >= 0 ? total : total - 86399) / 86400;
+			long long secondOfDay = total - days * 86400;
+			long long year;
+			unsigned month, day;
+			civilFromDays(days, year, month, day);
+
+			char buffer[48];
+			char* out = buffer;
+			*out++ = '\"';
+			if (year < 0) {
+				*out++ = '-';
+				year = -year;
+			}
+			out = writeDigits(out, static_cast<unsigned long long>(year), year > 9999 ? 5 : 4);
+			*out++ = '-';
+			out = writeDigits(out, month, 2);
+			*out++ = '-';
+			out = writeDigits(out, day, 2);
+			*out++ = 'T';
+			out = writeDigits(out, static_cast<unsigned long long>(secondOfDay / 3600), 2);
+			*out++ = ':';
+			out = writeDigits(out, static_cast<unsigned long long>(secondOfDay / 60 % 60), 2);
+			*out++ = ':';
+			out = writeDigits(out, static_cast<unsigned long long>(secondOfDay % 60), 2);
+			if (fraction) {
+				constexpr int digits = fractionDigits<typename Duration::period>();
+				if (digits > 0) {
+					long long nanos = duration_cast<nanoseconds>(sinceEpoch - seconds).count();
+					for (int i = digits; i < 9; ++i)
+						nanos /= 10;
+					*out++ = '.';
+					out = writeDigits(out, static_cast<unsigned long long>(nanos), digits);
+				}
+				*out++ = 'Z';
+			}
+			*out++ = '\"';
+			return os.write(buffer, out - buffer);
+		}
+
+		//Number of encoding units in value; floating point reps keep their fraction.
+		template<typename Rep, typename Period>
+		inline auto countIn(std::chrono::duration<Rep, Period> value, TimeEncoding encoding) noexcept {
+			using namespace std::chrono;
+			using Count = typename std::conditional<std::is_floating_point<Rep>::value, Rep, long long>::type;
+			switch (encoding) {
+			case TimeEncoding::Seconds:
+				return duration_cast<duration<Count>>(value).count();
+			case TimeEncoding::Millis:
+				return duration_cast<duration<Count, std::milli>>(value).count();
+			case TimeEncoding::Micros:
+				return duration_cast<duration<Count, std::micro>>(value).count();
+			default:
+				return duration_cast<duration<Count, std::nano>>(value).count();
+			}
+		}
+
+		template<typename Rep, typename Period>
+		inline std::ostream& writeCount(std::ostream& os, std::chrono::duration<Rep, Period> value, TimeEncoding encoding) noexcept {
+			auto count = countIn(value, encoding);
+			using Count = decltype(count);
+			if constexpr (std::is_floating_point<Count>::value)
+				return os << count;
+			else
+				return writeInteger(os, count);
+		}
+	}
+
+	namespace details
+	{
+		//Element types written by the BSON encoder.
+		enum class BsonType : char {
+			None = 0x00,
+			Double = 0x01,
+			String = 0x02,
+			Document = 0x03,
+			Array = 0x04,
+			Boolean = 0x08,
+			DateTime = 0x09,
+			Null = 0x0A,
+			Int32 = 0x10,
+			Int64 = 0x12
+		};
+
+		template<typename U>
+		inline char* putLittle(char* out, U value) noexcept {
+			for (size_t i = 0; i < sizeof(U); ++i)
+				out[i] = static_cast<char>(value >> (8 * i));
+			return out + sizeof(U);
+		}
+
+		template<typename U>
+		inline void appendLittle(std::string& out, U value) {
+			char bytes[sizeof(U)];
+			putLittle(bytes, value);
+			out.append(bytes, sizeof(U));
+		}
+
+		//Element header: type byte and the name as a NUL terminated C string.
+		inline void bsonKey(std::string& out, BsonType type, std::string_view key) {
+			if (key.find('\0') != std::string_view::npos)
+				throw std::invalid_argument("BSON: member names cannot contain NUL");
+			out += static_cast<char>(type);
+			out.append(key.data(), key.size());
+			out += '\0';
+		}
+
+		//Documents and arrays are written in one pass: bsonBegin leaves room for the
+		//length, bsonEnd terminates the document and patches the length in.
+		inline size_t bsonBegin(std::string& out) {
+			size_t start = out.size();
+			out.append(4, '\0');
+			return start;
+		}
+
+		inline void bsonEnd(std::string& out, size_t start) {
+			out += '\0';
+			size_t length = out.size() - start;
+			if (length > INT32_MAX)
+				throw std::length_error("BSON: document larger than 2 GiB");
+			putLittle(&out[start], static_cast<uint32_t>(length));
+		}
+
+		inline void bsonString(std::string& out, std::string_view key, std::string_view value) {
+			if (value.size() >= INT32_MAX)
+				throw std::length_error("BSON: string larger than 2 GiB");
+			bsonKey(out, BsonType::String, key);
+			appendLittle(out, static_cast<uint32_t>(value.size() + 1));
+			out.append(value.data(), value.size());
+			out += '\0';
+		}
+
+		//Element type a value of T always encodes to, None when it depends on the value.
+		template<typename T>
+		constexpr BsonType bsonTypeOf() {
+			if constexpr (std::is_same<T, bool>::value)
+				return BsonType::Boolean;
+			else if constexpr (std::is_floating_point<T>::value)
+				return BsonType::Double;
+			else if constexpr (std::is_integral<T>::value && (sizeof(T) < 4 || (sizeof(T) == 4 && std::is_signed<T>::value)))
+				return BsonType::Int32;
+			else if constexpr (std::is_integral<T>::value && (sizeof(T) < 8 || (sizeof(T) == 8 && std::is_signed<T>::value)))
+				return BsonType::Int64;
+			else
+				return BsonType::None;
+		}
+
+		//Stores the payload of a value whose bsonTypeOf is not None.
+		template<typename T>
+		inline char* putScalar(char* out, T value) noexcept {
+			constexpr BsonType type = bsonTypeOf<T>();
+			if constexpr (type == BsonType::Boolean) {
+				*out = value ? 1 : 0;
+				return out + 1;
+			}
+			else if constexpr (type == BsonType::Double) {
+				double number = static_cast<double>(value);
+				uint64_t bits;
+				std::memcpy(&bits, &number, sizeof(bits));
+				return putLittle(out, bits);
+			}
+			else if constexpr (type == BsonType::Int32)
+				return putLittle(out, static_cast<uint32_t>(static_cast<int32_t>(value)));
+			else
+				return putLittle(out, static_cast<uint64_t>(static_cast<int64_t>(value)));
+		}
+
+		template<typename T>
+		inline void bsonScalar(std::string& out, std::string_view key, T value) {
+			constexpr BsonType type = bsonTypeOf<T>();
+			if constexpr (type == BsonType::None) {
+				if (value <= static_cast<T>(INT64_MAX))
+					bsonScalar(out, key, static_cast<int64_t>(value));
+				else
+					bsonScalar(out, key, static_cast<double>(value));
+			}
+			else {
+				bsonKey(out, type, key);
+				char payload[8];
+				out.append(payload, static_cast<size_t>(putScalar(payload, value) - payload));
+			}
+		}
+
+		inline void bsonDateTime(std::string& out, std::string_view key, long long millis) {
+			bsonKey(out, BsonType::DateTime, key);
+			appendLittle(out, static_cast<uint64_t>(millis));
+		}
+
+		//Day count since 1970-01-01 of a proleptic Gregorian date; inverse of civilFromDays.
+		inline long long daysFromCivil(long long year, unsigned month, unsigned day) noexcept {
+			year -= month <= 2;
+			long long era = (year >= 0 ? year : year - 399) / 400;
+			unsigned yearOfEra = static_cast<unsigned>(year - era * 400);
+			unsigned dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+			unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+			return era * 146097 + static_cast<long long>(dayOfEra) - 719468;
+		}
+	}
+
+	namespace details
+	{
+		//Size-class free lists for node allocations. Each thread allocates from its own
+		//pool without locking; blocks freed on another thread are collected in small
+		//per-thread batches and handed back to their owner with one CAS per batch.
+		//Pools are never destroyed: the pool of an exited thread is adopted by the next one.
+		class NodePool {
+		private:
+			static const size_t granularity = 16;
+			static const size_t classes = 32;
+			static const size_t blocksPerChunk = 64;
+			static const size_t batchSize = 32;
+			static const size_t batchSlots = 8;
+
+			struct Block {
+				Block* next;
+			};
+
+			struct alignas(16) Header {
+				NodePool* owner;
+				size_t sizeClass;
+			};
+
+			struct Batch {
+				NodePool* owner = nullptr;
+				size_t sizeClass = 0;
+				size_t count = 0;
+				Block* head = nullptr;
+				Block* tail = nullptr;
+			};
+
+			struct ThreadCache {
+				NodePool* pool;
+				Batch batches[batchSlots];
+				size_t nextVictim = 0;
+
+				inline static thread_local ThreadCache* live = nullptr;
+				inline static thread_local bool finished = false;
+
+				ThreadCache() {
+					std::lock_guard<std::mutex> lock(orphanMutex());
+					if (orphans().empty()) {
+						pool = new NodePool();
+					}
+					else {
+						pool = orphans().back();
+						orphans().pop_back();
+					}
+					live = this;
+				}
+
+				~ThreadCache() {
+					for (Batch& batch : batches)
+						flush(batch);
+					live = nullptr;
+					finished = true;
+					std::lock_guard<std::mutex> lock(orphanMutex());
+					orphans().push_back(pool);
+				}
+
+				void defer(NodePool* owner, size_t sizeClass, Block* block) noexcept {
+					Batch* target = nullptr;
+					for (Batch& batch : batches) {
+						if (batch.owner == owner && batch.sizeClass == sizeClass) {
+							target = &batch;
+							break;
+						}
+						if (!target && !batch.owner)
+							target = &batch;
+					}
+					if (!target) {
+						target = &batches[nextVictim++ % batchSlots];
+						flush(*target);
+					}
+					if (!target->owner) {
+						target->owner = owner;
+						target->sizeClass = sizeClass;
+						target->tail = block;
+					}
+					block->next = target->head;
+					target->head = block;
+					if (++target->count >= batchSize)
+						flush(*target);
+				}
+
+				static void flush(Batch& batch) noexcept {
+					if (batch.owner)
+						batch.owner->pushRemote(batch.sizeClass, batch.head, batch.tail);
+					batch = Batch();
+				}
+			};
+
+			Block* local[classes] = {};
+			std::atomic<Block*> remote[classes] = {};
+
+			static std::mutex& orphanMutex() {
+				static std::mutex* mutex = new std::mutex();
+				return *mutex;
+			}
+
+			static std::vector<NodePool*>& orphans() {
+				static std::vector<NodePool*>* pools = new std::vector<NodePool*>();
+				return *pools;
+			}
+
+			static ThreadCache* threadCache() {
+				if (ThreadCache::live || ThreadCache::finished)
+					return ThreadCache::live;
+				thread_local ThreadCache cache;
+				return &cache;
+			}
+
+			void pushRemote(size_t sizeClass, Block* head, Block* tail) noexcept {
+				Block* top = remote[sizeClass].load(std::memory_order_relaxed);
+				do {
+					tail->next = top;
+				} while (!remote[sizeClass].compare_exchange_weak(top, head, std::memory_order_release, std::memory_order_relaxed));
+			}
+
+			Block* refill(size_t sizeClass) {
+				Block* returned = remote[sizeClass].exchange(nullptr, std::memory_order_acquire);
+				if (returned)
+					return returned;
+
+				size_t blockSize = (sizeClass + 1) * granularity;
+				char* chunk = static_cast<char*>(::operator new(blockSize * blocksPerChunk));
+				for (size_t i = 0; i < blocksPerChunk; ++i)
+					reinterpret_cast<Block*>(chunk + i * blockSize)->next = i + 1 < blocksPerChunk ? reinterpret_cast<Block*>(chunk + (i + 1) * blockSize) : nullptr;
+				return reinterpret_cast<Block*>(chunk);
+			}
+		public:
+			//Largest allocation served from the size classes; larger ones go to operator new.
+			static constexpr size_t largest = classes * granularity - sizeof(Header);
+
+			static void* allocate(size_t size) {
+				size_t sizeClass = (size + sizeof(Header) - 1) / granularity;
+				ThreadCache* cache = sizeClass < classes ? threadCache() : nullptr;
+				Header* header;
+				if (!cache) {
+					header = static_cast<Header*>(::operator new(size + sizeof(Header)));
+					header->owner = nullptr;
+				}
+				else {
+					NodePool* pool = cache->pool;
+					Block* block = pool->local[sizeClass] ? pool->local[sizeClass] : pool->refill(sizeClass);
+					pool->local[sizeClass] = block->next;
+					header = reinterpret_cast<Header*>(block);
+					header->owner = pool;
+				}
+				header->sizeClass = sizeClass;
+				return header + 1;
+			}
+
+			static void deallocate(void* pointer) noexcept {
+				Header* header = static_cast<Header*>(pointer) - 1;
+				NodePool* owner = header->owner;
+				size_t sizeClass = header->sizeClass;
+				if (!owner) {
+					::operator delete(header);
+					return;
+				}
+
+				Block* block = reinterpret_cast<Block*>(header);
+				ThreadCache* cache = threadCache();
+				if (cache && cache->pool == owner) {
+					block->next = owner->local[sizeClass];
+					owner->local[sizeClass] = block;
+				}
+				else if (cache) {
+					cache->defer(owner, sizeClass, block);
+				}
+				else {
+					owner->pushRemote(sizeClass, block, block);
+				}
+			}
+		};
+
+		template<typename T>
+		struct PoolAllocator {
+			typedef T value_type;
+
+			PoolAllocator() noexcept {}
+
+			template<typename U>
+			PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+			T* allocate(size_t count) {
+				return static_cast<T*>(NodePool::allocate(count * sizeof(T)));
+			}
+
+			void deallocate(T* pointer, size_t) noexcept {
+				NodePool::deallocate(pointer);
+			}
+
+			template<typename U>
+			bool operator==(const PoolAllocator<U>&) const noexcept {
+				return true;
+			}
+
+			template<typename U>
+			bool operator!=(const PoolAllocator<U>&) const noexcept {
+				return false;
+			}
+		};
+
+		//Every node of a tree is allocated here; define JSON_WRITER_NO_POOL to use make_shared.
+		template<typename N, typename... Args>
+		inline std::shared_ptr<N> makeNode(Args&&... args) {
+#ifndef JSON_WRITER_NO_POOL
+			if constexpr (alignof(N) <= 16)
+				return std::allocate_shared<N>(PoolAllocator<N>(), std::forward<Args>(args)...);
+			else
+#endif
+				return std::make_shared<N>(std::forward<Args>(args)...);
+		}
+
+		//Vector keeping up to N elements inside the owning node; grows to the heap beyond that.
+		template<typename T, size_t N>
+		class SmallVector {
+		private:
+			T* first;
+			size_t count = 0;
+			size_t capacity_ = N;
+			alignas(T) unsigned char storage[N * sizeof(T)];
+
+			T* inlineData() noexcept {
+				return reinterpret_cast<T*>(storage);
+			}
+
+			bool isInline() const noexcept {
+				return first == reinterpret_cast<const T*>(storage);
+			}
+
+			void grow(size_t minimum) {
+				size_t capacity = capacity_ * 2 > minimum ? capacity_ * 2 : minimum;
+				T* data = static_cast<T*>(::operator new(capacity * sizeof(T)));
+				for (size_t i = 0; i < count; ++i) {
+					new (data + i) T(std::move_if_noexcept(first[i]));
+					first[i].~T();
+				}
+				release();
+				first = data;
+				capacity_ = capacity;
+			}
+
+			void release() noexcept {
+				if (!isInline())
+					::operator delete(first);
+			}
+		public:
+			typedef T value_type;
+			typedef T* iterator;
+			typedef const T* const_iterator;
+
+			SmallVector() noexcept
+				:first(inlineData()) {}
+
+			template<typename It>
+			SmallVector(It begin, It end)
+				:SmallVector() {
+				assign(begin, end);
+			}
+
+			SmallVector(const SmallVector& other)
+				:SmallVector() {
+				assign(other.begin(), other.end());
+			}
+
+			SmallVector(SmallVector&& other) noexcept(std::is_nothrow_move_constructible<T>::value)
+				:SmallVector() {
+				*this = std::move(other);
+			}
+
+			~SmallVector() {
+				clear();
+				release();
+			}
+
+			SmallVector& operator=(const SmallVector& other) {
+				if (this != &other)
+					assign(other.begin(), other.end());
+				return *this;
+			}
+
+			SmallVector& operator=(SmallVector&& other) noexcept(std::is_nothrow_move_constructible<T>::value) {
+				if (this == &other)
+					return *this;
+				clear();
+				if (other.isInline()) {
+					for (size_t i = 0; i < other.count; ++i)
+						new (first + i) T(std::move(other.first[i]));
+					count = other.count;
+					other.clear();
+				}
+				else {
+					release();
+					first = other.first;
+					count = other.count;
+					capacity_ = other.capacity_;
+					other.first = other.inlineData();
+					other.count = 0;
+					other.capacity_ = N;
+				}
+				return *this;
+			}
+
+			template<typename It>
+			void assign(It begin, It end) {
+				clear();
+				for (; begin != end; ++begin)
+					emplace_back(*begin);
+			}
+
+			template<typename... Args>
+			T& emplace_back(Args&&... args) {
+				if (count == capacity_) {
+					T value(std::forward<Args>(args)...);
+					grow(count + 1);
+					return *new (first + count++) T(std::move(value));
+				}
+				return *new (first + count++) T(std::forward<Args>(args)...);
+			}
+
+			void push_back(const T& value) {
+				emplace_back(value);
+			}
+
+			void push_back(T&& value) {
+				emplace_back(std::move(value));
+			}
+
+			void reserve(size_t capacity) {
+				if (capacity > capacity_)
+					grow(capacity);
+			}
+
+			void clear() noexcept {
+				for (size_t i = 0; i < count; ++i)
+					first[i].~T();
+				count = 0;
+			}
+
+			size_t size() const noexcept { return count; }
+			size_t capacity() const noexcept { return capacity_; }
+			bool empty() const noexcept { return count == 0; }
+			T* data() noexcept { return first; }
+			const T* data() const noexcept { return first; }
+			T* begin() noexcept { return first; }
+			T* end() noexcept { return first + count; }
+			const T* begin() const noexcept { return first; }
+			const T* end() const noexcept { return first + count; }
+			T& operator[](size_t index) noexcept { return first[index]; }
+			const T& operator[](size_t index) const noexcept { return first[index]; }
+			T& back() noexcept { return first[count - 1]; }
+		};
+
+		//Inline element count for small containers: what fits in 64 bytes, 1 to 8.
+		template<typename T>
+		constexpr size_t inlineCapacity() {
+			return sizeof(T) >= 64 ? 1 : (64 / sizeof(T) > 8 ? 8 : 64 / sizeof(T));
+		}
+
+		//Type a value is stored as: C strings become std::string.
+		template<typename T>
+		using Stored = typename std::conditional<std::is_same<std::decay_t<T>, const char*>::value
+			|| std::is_same<std::decay_t<T>, char*>::value, std::string, std::decay_t<T>>::type;
+
+		template<typename T>
+		struct IsVector : std::false_type {};
+
+		template<typename T, typename A>
+		struct IsVector<std::vector<T, A>> : std::true_type {};
+
+		//RFC 6901 array index: "0" or digits without a leading zero.
+		inline bool parseIndex(std::string_view token, size_t& index) noexcept {
+			if (token.empty() || (token.size() > 1 && token[0] == '0'))
+				return false;
+			auto result = std::from_chars(token.data(), token.data() + token.size(), index);
+			return result.ec == std::errc() && result.ptr == token.data() + token.size();
+		}
+
+		//Minimal perfect hash (hash and displace) from a set of distinct key hashes to
+		//their positions: keys go to buckets of about four, and each bucket gets the
+		//first seed that moves all its keys to free slots.
+		class PerfectHash {
+		private:
+			std::vector<uint32_t> seeds;
+			std::vector<uint32_t> slots;
+
+			static size_t position(uint64_t hash, uint32_t seed, size_t count) noexcept {
+				uint64_t mixed = hash ^ (seed * 0x9E3779B97F4A7C15ull);
+				mixed ^= mixed >> 33;
+				mixed *= 0xFF51AFD7ED558CCDull;
+				mixed ^= mixed >> 33;
+				return static_cast<size_t>(mixed % count);
+			}
+		public:
+			static uint64_t hash(std::string_view key) noexcept {
+				return std::hash<std::string_view>()(key);
+			}
+
+			//False when no perfect hash was found, e.g. for colliding hashes.
+			bool build(const std::vector<uint64_t>& hashes) {
+				size_t count = hashes.size();
+				size_t bucketCount = (count + 3) / 4;
+				std::vector<std::vector<uint32_t>> buckets(bucketCount);
+				for (size_t i = 0; i < count; ++i)
+					buckets[(hashes[i] >> 32) % bucketCount].push_back(static_cast<uint32_t>(i));
+
+				std::vector<uint32_t> order(bucketCount);
+				for (size_t b = 0; b < bucketCount; ++b)
+					order[b] = static_cast<uint32_t>(b);
+				std::sort(order.begin(), order.end(), [&buckets](uint32_t a, uint32_t b) { return buckets[a].size() > buckets[b].size(); });
+
+				seeds.assign(bucketCount, 0);
+				slots.assign(count, 0);
+				std::vector<bool> taken(count, false);
+				std::vector<size_t> placed;
+				for (uint32_t b : order) {
+					if (buckets[b].empty())
+						break;
+					uint32_t seed = 1;
+					for (; seed < (1u << 20); ++seed) {
+						placed.clear();
+						for (uint32_t key : buckets[b]) {
+							size_t slot = position(hashes[key], seed, count);
+							if (taken[slot] || std::find(placed.begin(), placed.end(), slot) != placed.end())
+								break;
+							placed.push_back(slot);
+						}
+						if (placed.size() == buckets[b].size())
+							break;
+					}
+					if (placed.size() != buckets[b].size())
+						return false;
+					seeds[b] = seed;
+					for (size_t i = 0; i < placed.size(); ++i) {
+						taken[placed[i]] = true;
+						slots[placed[i]] = buckets[b][i];
+					}
+				}
+				return true;
+			}
+
+			//Position of the key with this hash; only meaningful for keys of the set.
+			size_t find(uint64_t hash) const noexcept {
+				return slots[position(hash, seeds[(hash >> 32) % seeds.size()], slots.size())];
+			}
+		};
+	}
+
+	class Node;
+	template<typename T>
+	class Value;
+	class Object;
+	template<typename T>
+	class Array;
+	class Overlay;
+
+	namespace details
+	{
+		//shared_ptr to a node, inserted as is so several parents can share it.
+		template<typename T>
+		struct IsNodePointer : std::false_type {};
+
+		template<typename N>
+		struct IsNodePointer<std::shared_ptr<N>> : std::is_base_of<Node, N> {};
+
+		struct StaticWriter;
+	}
+
+	//What Object::merge does with a name present on both sides.
+	enum class Conflict {
+		Overwrite,
+		Keep,
+		Throw
+	};
+
+	//Read-only view of a node, of the value held by a Value<T> node or of an array
+	//element, as returned by Object::find and Node::pointer. Empty when nothing was found.
+	class Ref {
+	private:
+		const Node* node = nullptr;
+		const void* leaf = nullptr;
+		const std::type_info* type = nullptr;
+		size_t row;
+	public:
+		static const size_t npos = static_cast<size_t>(-1);
+
+		Ref()
+			:row(npos) {}
+
+		Ref(const Node* node, const void* leaf = nullptr, const std::type_info* type = nullptr, size_t row = npos)
+			:node(node), leaf(leaf), type(type), row(row) {}
+
+		explicit operator bool() const {
+			return node || leaf;
+		}
+
+		//The node or value as T, nullptr when it is something else.
+		template<typename T>
+		const T* as() const;
+
+		Ref operator[](std::string_view name) const;
+
+		Ref operator[](size_t index) const;
+
+		//Resolves an RFC 6901 JSON Pointer ("/a/0/b", with ~0 for '~' and ~1 for '/').
+		Ref pointer(std::string_view path) const;
+	};
+
+	class Node {
+	private:
+		virtual std::ostream& write(std::ostream& os) const noexcept = 0;
+
+		//Appends this node as the BSON element key. Nodes without a BSON form of their
+		//own are stored as a string holding their JSON text.
+		virtual void writeBson(std::string& out, std::string_view key) const {
+			std::ostringstream os;
+			os.imbue(std::locale(os.getloc(), new details::DecimalPointFacet()));
+			write(os);
+			details::bsonString(out, key, os.str());
+		}
+
+		friend class Ref;
+		friend struct details::StaticWriter;
+	protected:
+		//Member or element named by one JSON Pointer token; row addresses a row of tabular nodes.
+		virtual Ref child(std::string_view token, size_t row) const {
+			(void)token;
+			(void)row;
+			return Ref();
+		}
+
+		//------------WriterImpl---------------//
+		//Nested nodes are written directly; only the root goes through operator<<.
+		template<typename T>
+		inline static std::ostream& writeImpl(std::ostream& os, const T& value) noexcept {
+			if constexpr (std::is_base_of<Node, T>::value)
+				return static_cast<const Node&>(value).write(os);
+			else if constexpr (details::IsNodePointer<T>::value)
+				return static_cast<const Node&>(*value).write(os);
+			else if constexpr (std::is_enum<T>::value) {
+				if constexpr (details::HasEnumNames<T>::value) {
+					size_t size;
+					if (const char* token = details::enumToken(value, size))
+						return os.write(token, static_cast<std::streamsize>(size));
+				}
+				return os << +static_cast<std::underlying_type_t<T>>(value);
+			}
+			else if constexpr (details::IsFastInteger<T>::value)
+				return details::writeInteger(os, value);
+			else
+				return os << value;
+		}
+
+		template<typename Clock, typename Duration>
+		inline static std::ostream& writeImpl(std::ostream& os, const std::chrono::time_point<Clock, Duration>& value) noexcept {
+			return writeImpl(os, Time<std::chrono::time_point<Clock, Duration>>(value, TimeEncoding::Rfc3339));
+		}
+
+		template<typename Rep, typename Period>
+		inline static std::ostream& writeImpl(std::ostream& os, const std::chrono::duration<Rep, Period>& value) noexcept {
+			return writeImpl(os, value.count());
+		}
+
+		template<typename Clock, typename Duration>
+		inline static std::ostream& writeImpl(std::ostream& os, const Time<std::chrono::time_point<Clock, Duration>>& value) noexcept {
+			auto sinceEpoch = value.value.time_since_epoch();
+			switch (value.encoding) {
+			case TimeEncoding::Iso:
+				return details::writeCalendar(os, sinceEpoch, false);
+			case TimeEncoding::Rfc3339:
+				return details::writeCalendar(os, sinceEpoch, true);
+			default:
+				return details::writeCount(os, sinceEpoch, value.encoding);
+			}
+		}
+
+		//Calendar encodings write durations as ISO 8601 "PT<seconds>S".
+		template<typename Rep, typename Period>
+		inline static std::ostream& writeImpl(std::ostream& os, const Time<std::chrono::duration<Rep, Period>>& value) noexcept {
+			if (value.encoding != TimeEncoding::Iso && value.encoding != TimeEncoding::Rfc3339)
+				return details::writeCount(os, value.value, value.encoding);
+			os << "\"PT";
+			writeImpl(os, std::chrono::duration<double>(value.value).count());
+			return os << "S\"";
+		}
+
+		inline static std::ostream& writeImpl(std::ostream& os, const std::tm& value) {
+			return os << '\"' << std::put_time(&value, "%Y-%m-%dT%H:%M:%S") << '\"';
+		}
+
+		static std::ostream& writeImpl(std::ostream& os, const std::string& value) noexcept{
+			std::string escaped;
+			escaped.reserve(value.size() + 2);
+			details::appendEscaped(escaped, value.data(), value.size());
+			return os.write(escaped.data(), static_cast<std::streamsize>(escaped.size()));
+		}
+
+		//------------BsonImpl---------------//
+		template<typename T>
+		static void bsonImpl(std::string& out, std::string_view key, const T& value) {
+			if constexpr (std::is_base_of<Node, T>::value)
+				static_cast<const Node&>(value).writeBson(out, key);
+			else if constexpr (details::IsNodePointer<T>::value)
+				static_cast<const Node&>(*value).writeBson(out, key);
+			else if constexpr (std::is_enum<T>::value) {
+				if constexpr (details::HasEnumNames<T>::value) {
+					size_t index = details::enumIndex(value);
+					if (index < std::size(EnumNames<T>::entries))
+						return details::bsonString(out, key, EnumNames<T>::entries[index].name);
+				}
+				details::bsonScalar(out, key, static_cast<std::underlying_type_t<T>>(value));
+			}
+			else if constexpr (std::is_arithmetic<T>::value)
+				details::bsonScalar(out, key, value);
+			else {
+				std::ostringstream os;
+				os.imbue(std::locale(os.getloc(), new details::DecimalPointFacet()));
+				writeImpl(os, value);
+				details::bsonString(out, key, os.str());
+			}
+		}
+
+		//Time points become UTC datetimes in milliseconds since the clock's epoch.
+		template<typename Clock, typename Duration>
+		static void bsonImpl(std::string& out, std::string_view key, const std::chrono::time_point<Clock, Duration>& value) {
+			using namespace std::chrono;
+			details::bsonDateTime(out, key, floor<milliseconds>(value.time_since_epoch()).count());
+		}
+
+		template<typename Rep, typename Period>
+		static void bsonImpl(std::string& out, std::string_view key, const std::chrono::duration<Rep, Period>& value) {
+			details::bsonScalar(out, key, value.count());
+		}
+
+		template<typename Clock, typename Duration>
+		static void bsonImpl(std::string& out, std::string_view key, const Time<std::chrono::time_point<Clock, Duration>>& value) {
+			if (value.encoding == TimeEncoding::Iso || value.encoding == TimeEncoding::Rfc3339)
+				bsonImpl(out, key, value.value);
+			else
+				details::bsonScalar(out, key, details::countIn(value.value.time_since_epoch(), value.encoding));
+		}
+
+		template<typename Rep, typename Period>
+		static void bsonImpl(std::string& out, std::string_view key, const Time<std::chrono::duration<Rep, Period>>& value) {
+			if (value.encoding != TimeEncoding::Iso && value.encoding != TimeEncoding::Rfc3339)
+				return details::bsonScalar(out, key, details::countIn(value.value, value.encoding));
+			std::ostringstream os;
+			os.imbue(std::locale(os.getloc(), new details::DecimalPointFacet()));
+			os << "PT";
+			writeImpl(os, std::chrono::duration<double>(value.value).count());
+			os << 'S';
+			details::bsonString(out, key, os.str());
+		}
+
+		//The fields are taken as UTC, as the JSON form carries no zone either.
+		static void bsonImpl(std::string& out, std::string_view key, const std::tm& value) {
+			long long days = details::daysFromCivil(value.tm_year + 1900LL, static_cast<unsigned>(value.tm_mon + 1), static_cast<unsigned>(value.tm_mday));
+			long long seconds = days * 86400 + value.tm_hour * 3600LL + value.tm_min * 60LL + value.tm_sec;
+			details::bsonDateTime(out, key, seconds * 1000);
+		}
+
+		static void bsonImpl(std::string& out, std::string_view key, const std::string& value) {
+			details::bsonString(out, key, value);
+		}
+	public:
+		friend std::ostream& operator<<(std::ostream& os, const Node& node) {
+			JSON_WRITER_PROBE2(document__begin, &node, os.rdbuf());
+			os.imbue(std::locale(os.getloc(),new details::DecimalPointFacet()));
+			node.write(os);
+			JSON_WRITER_PROBE3(document__end, &node, os.rdbuf(), os.fail());
+			return os;
+		}
+
+		virtual ~Node() {};
+
+		virtual Ref ref() const {
+			return Ref(this);
+		}
+
+		Ref pointer(std::string_view path) const {
+			return ref().pointer(path);
+		}
+
+		template<typename T>
+		static std::shared_ptr<Node> create(T&& rval);
+
+		template<typename T>
+		static std::shared_ptr<Node> create(std::initializer_list<T> value);
+	};
+
+
+	namespace details
+	{
+		template<typename T>
+		inline Ref refTo(const T& value) {
+			if constexpr (std::is_base_of<Node, T>::value)
+				return value.ref();
+			else if constexpr (IsNodePointer<T>::value)
+				return value->ref();
+			else
+				return Ref(nullptr, &value, &typeid(T));
+		}
+	}
+
+	template<typename T>
+	class Array : public Node {
+	private:
+		details::SmallVector<T, details::inlineCapacity<T>()> children;
+
+		virtual Ref child(std::string_view token, size_t) const override {
+			size_t index;
+			if (!details::parseIndex(token, index) || index >= children.size())
+				return Ref();
+			return details::refTo(children[index]);
+		}
+
+		virtual std::ostream& write(std::ostream& os) const noexcept override {
+			os << '[';
+			for (auto it = children.begin(); it != children.end(); ++it) {
+				writeImpl(os, *it);
+				if (std::next(it) != children.end())
+					os << ',';
+			}
+			os << ']';
+
+			return os;
+		}
+
+		virtual void writeBson(std::string& out, std::string_view key) const override {
+			details::bsonKey(out, details::BsonType::Array, key);
+			size_t start = details::bsonBegin(out);
+			constexpr details::BsonType type = details::bsonTypeOf<T>();
+			if constexpr (type != details::BsonType::None) {
+				//Every element has the same type and width: size the output once and store
+				//the elements back to back without looking at them one by one.
+				constexpr size_t width = type == details::BsonType::Boolean ? 1 : type == details::BsonType::Int32 ? 4 : 8;
+				size_t used = out.size();
+				out.resize(used + children.size() * (width + 22));
+				char* at = &out[used];
+				for (size_t i = 0; i < children.size(); ++i) {
+					*at++ = static_cast<char>(type);
+					at = std::to_chars(at, at + 20, i).ptr;
+					*at++ = '\0';
+					at = details::putScalar(at, children[i]);
+				}
+				out.resize(static_cast<size_t>(at - out.data()));
+			}
+			else {
+				char index[24];
+				for (size_t i = 0; i < children.size(); ++i) {
+					auto result = std::to_chars(index, index + sizeof(index), i);
+					bsonImpl(out, std::string_view(index, static_cast<size_t>(result.ptr - index)), children[i]);
+				}
+			}
+			details::bsonEnd(out, start);
+		}
+	public:
+		Array() {}
+
+		Array(const std::vector<T>& children)
+			:children(children.begin(), children.end()) {}
+
+		Array(std::vector<T>&& children)
+			:children(std::make_move_iterator(children.begin()), std::make_move_iterator(children.end())) {}
+
+		Array(std::initializer_list<T> children)
+			:children(children.begin(), children.end()) {}
+
+		template<typename It>
+		Array(It first, It last)
+			:children(first, last) {}
+
+		Array& operator()(const T& val) {
+			children.push_back(val);
+			return *this;
+		}
+
+		Array& operator()(T&& val) {
+			children.push_back(std::move(val));
+			return *this;
+		}
+
+		template<typename... Args>
+		T& emplace_back(Args&&... args) {
+			children.emplace_back(std::forward<Args>(args)...);
+			return children.back();
+		}
+
+		//Replaces the elements, reusing the existing capacity.
+		template<typename It>
+		void assign(It first, It last) {
+			children.assign(first, last);
+		}
+
+		void clear() {
+			children.clear();
+		}
+
+		void reserve(size_t count) {
+			children.reserve(count);
+		}
+
+		size_t size() const {
+			return children.size();
+		}
+
+		const T& at(size_t index) const {
+			if (index >= children.size())
+				throw std::out_of_range("Array::at: index out of range");
+			return children[index];
+		}
+
+		T& at(size_t index) {
+			if (index >= children.size())
+				throw std::out_of_range("Array::at: index out of range");
+			return children[index];
+		}
+
+		//Concatenation; elements of an rvalue are moved over, never copied.
+		Array& append(Array&& other) {
+			children.reserve(children.size() + other.children.size());
+			for (T& value : other.children)
+				children.push_back(std::move(value));
+			other.children.clear();
+			return *this;
+		}
+
+		Array& append(const Array& other) {
+			children.reserve(children.size() + other.children.size());
+			for (const T& value : other.children)
+				children.push_back(value);
+			return *this;
+		}
+	};
+
+	template<typename T>
+	class Value : public Node {
+	private:
+		T value;
+
+		virtual void writeBson(std::string& out, std::string_view key) const override {
+			bsonImpl(out, key, value);
+		}
+	public:
+		Value(const T& value)
+			:value(value) {}
+
+		Value(T&& value)
+			:value(std::move(value)) {}
+
+		template<typename... Args>
+		Value(std::in_place_t, Args&&... args)
+			:value(std::forward<Args>(args)...) {}
+
+		T& get() {
+			return value;
+		}
+
+		const T& get() const {
+			return value;
+		}
+
+		virtual Ref ref() const override {
+			return Ref(this, &value, &typeid(T));
+		}
+
+		virtual std::ostream& write(std::ostream& os) const noexcept override {
+			return writeImpl(os, value);
+		}
+	};
+
+	class Object : public Node {
+	private:
+		friend class Overlay;
+
+		struct Entry {
+			std::string name;
+			std::shared_ptr<Node> node;
+		};
+
+		typedef std::unordered_map<std::string_view, size_t> NameMap;
+
+		//Hash index over the entry names, only kept for larger objects. It holds views
+		//into the entries, so it is dropped whenever they move and rebuilt on demand.
+		//Const lookups on several threads may build it at once; the first map published
+		//wins and the others are discarded. The perfect hash of a frozen object maps to
+		//positions and survives copies.
+		struct Index {
+			std::atomic<NameMap*> map{ nullptr };
+			std::shared_ptr<const details::PerfectHash> perfect;
+
+			Index() {}
+			Index(const Index& other) :perfect(other.perfect) {}
+			Index(Index&& other) noexcept :perfect(std::move(other.perfect)) {}
+			~Index() { reset(); }
+			Index& operator=(const Index& other) { reset(); perfect = other.perfect; return *this; }
+			Index& operator=(Index&& other) noexcept { reset(); perfect = std::move(other.perfect); return *this; }
+
+			void reset() noexcept {
+				delete map.exchange(nullptr, std::memory_order_relaxed);
+			}
+		};
+
+		static const size_t indexThreshold = 16;
+
+		details::SmallVector<Entry, 4> children;
+		mutable Index index;
+
+		Entry* lookup(std::string_view name) const {
+			Entry* entries = const_cast<Entry*>(children.data());
+			if (index.perfect) {
+				Entry* entry = entries + index.perfect->find(details::PerfectHash::hash(name));
+				return entry->name == name ? entry : nullptr;
+			}
+			if (children.size() <= indexThreshold) {
+				for (size_t i = 0; i < children.size(); ++i)
+					if (entries[i].name == name)
+						return entries + i;
+				return nullptr;
+			}
+			NameMap* map = index.map.load(std::memory_order_acquire);
+			if (!map) {
+				std::unique_ptr<NameMap> built(new NameMap(children.size() * 2));
+				for (size_t i = 0; i < children.size(); ++i)
+					built->emplace(entries[i].name, i);
+				if (index.map.compare_exchange_strong(map, built.get(), std::memory_order_acq_rel, std::memory_order_acquire))
+					map = built.release();
+			}
+			auto it = map->find(name);
+			return it == map->end() ? nullptr : entries + it->second;
+		}
+
+		std::shared_ptr<Node>& append(std::string&& name) {
+			index.perfect.reset();
+			size_t capacity = children.capacity();
+			children.push_back(Entry{ std::move(name), nullptr });
+			if (children.capacity() != capacity)
+				index.reset();
+			else if (NameMap* map = index.map.load(std::memory_order_relaxed))
+				map->emplace(children.back().name, children.size() - 1);
+			return children.back().node;
+		}
+
+		//Node slot for name, appended empty when missing.
+		std::shared_ptr<Node>& slot(std::string&& name) {
+			Entry* entry = lookup(name);
+			return entry ? entry->node : append(std::move(name));
+		}
+
+		static bool isObject(const std::shared_ptr<Node>& node) {
+			return node && typeid(*node) == typeid(Object);
+		}
+
+		void checkConflicts(const Object& other, bool deep) const {
+			for (const Entry& entry : other.children) {
+				Entry* existing = lookup(entry.name);
+				if (!existing)
+					continue;
+				if (!deep || !isObject(existing->node) || !isObject(entry.node))
+					throw std::invalid_argument("Object::merge: member \"" + entry.name + "\" exists on both sides");
+				static_cast<const Object&>(*existing->node).checkConflicts(static_cast<const Object&>(*entry.node), deep);
+			}
+		}
+
+		void mergeEntry(std::string&& name, std::shared_ptr<Node>&& node, bool owned, Conflict conflict, bool deep) {
+			Entry* entry = lookup(name);
+			if (!entry) {
+				append(std::move(name)) = std::move(node);
+				return;
+			}
+			if (deep && isObject(entry->node) && isObject(node)) {
+				Object& target = child<Object>(name);
+				if (owned && node.use_count() == 1)
+					target.merge(std::move(static_cast<Object&>(*node)), conflict, deep);
+				else
+					target.merge(static_cast<const Object&>(*node), conflict, deep);
+				return;
+			}
+			if (conflict == Conflict::Overwrite)
+				entry->node = std::move(node);
+		}
+
+		std::shared_ptr<Node>& slot(std::string_view name) {
+			Entry* entry = lookup(name);
+			return entry ? entry->node : append(std::string(name));
+		}
+
+		//Existing child of type N, unshared first; replaced by an empty N when missing or of another type.
+		template<typename N>
+		N& child(std::string_view name) {
+			std::shared_ptr<Node>& node = slot(name);
+			if (!node || typeid(*node) != typeid(N))
+				node = details::makeNode<N>();
+			else if (node.use_count() > 1)
+				node = details::makeNode<N>(static_cast<const N&>(*node));
+			return static_cast<N&>(*node);
+		}
+
+		template<typename N, typename T>
+		static bool assignInPlace(std::shared_ptr<Node>& node, T&& value) {
+			if (node.use_count() != 1 || typeid(*node) != typeid(N))
+				return false;
+			if constexpr (std::is_base_of<Node, std::decay_t<T>>::value)
+				static_cast<N&>(*node) = std::forward<T>(value);
+			else if constexpr (details::IsVector<std::decay_t<T>>::value)
+				static_cast<N&>(*node).assign(value.begin(), value.end());
+			else
+				static_cast<N&>(*node).get() = std::forward<T>(value);
+			return true;
+		}
+
+		virtual Ref child(std::string_view token, size_t) const override {
+			return find(token);
+		}
+
+		virtual std::ostream& write(std::ostream& os) const noexcept override;
+
+		void writeDocument(std::string& out) const;
+
+		virtual void writeBson(std::string& out, std::string_view key) const override {
+			details::bsonKey(out, details::BsonType::Document, key);
+			writeDocument(out);
+		}
+	public:
+		Object() {}
+
+		template<typename T>
+		Object& operator()(std::string name, T&& value) & {
+			slot(std::move(name)) = Node::create(std::forward<T>(value));
+			return *this;
+		}
+
+		template<typename T>
+		Object& operator()(std::string name, std::initializer_list<T> value) & {
+			slot(std::move(name)) = Node::create(value);
+			return *this;
+		}
+
+		//Temporaries stay rvalues so a nested Object()(...)(...) is moved, not copied, into its parent.
+		template<typename T>
+		Object&& operator()(std::string name, T&& value) && {
+			return std::move((*this)(std::move(name), std::forward<T>(value)));
+		}
+
+		template<typename T>
+		Object&& operator()(std::string name, std::initializer_list<T> value) && {
+			return std::move((*this)(std::move(name), value));
+		}
+
+		//Constructs the value in place and returns it: a Node type (Object, Array<U>, ...)
+		//is returned itself, any other T as the value held by its Value<T> node.
+		template<typename T, typename... Args>
+		T& emplace(std::string name, Args&&... args) {
+			if constexpr (std::is_base_of<Node, T>::value) {
+				auto node = details::makeNode<T>(std::forward<Args>(args)...);
+				T& result = *node;
+				slot(std::move(name)) = std::move(node);
+				return result;
+			}
+			else {
+				auto node = details::makeNode<Value<T>>(std::in_place, std::forward<Args>(args)...);
+				T& result = node->get();
+				slot(std::move(name)) = std::move(node);
+				return result;
+			}
+		}
+
+		//Rebinds a value for documents rebuilt with the same shape: when name already holds
+		//an unshared node of the matching type the value is assigned into it, keeping the
+		//node and its capacity; otherwise it behaves like operator().
+		template<typename T>
+		Object& set(std::string_view name, T&& value) {
+			using Type = std::decay_t<T>;
+			Entry* entry = lookup(name);
+			if (!entry)
+				return (*this)(std::string(name), std::forward<T>(value));
+
+			bool assigned;
+			if constexpr (details::IsNodePointer<Type>::value)
+				assigned = false;
+			else if constexpr (std::is_base_of<Node, Type>::value)
+				assigned = assignInPlace<Type>(entry->node, std::forward<T>(value));
+			else if constexpr (details::IsVector<Type>::value)
+				assigned = assignInPlace<Array<details::Stored<typename Type::value_type>>>(entry->node, std::forward<T>(value));
+			else
+				assigned = assignInPlace<Value<details::Stored<T>>>(entry->node, std::forward<T>(value));
+			if (!assigned)
+				entry->node = Node::create(std::forward<T>(value));
+			return *this;
+		}
+
+		template<typename T>
+		Object& set(std::string_view name, std::initializer_list<T> value) {
+			using N = Array<details::Stored<T>>;
+			Entry* entry = lookup(name);
+			if (entry && entry->node.use_count() == 1 && typeid(*entry->node) == typeid(N))
+				static_cast<N&>(*entry->node).assign(value.begin(), value.end());
+			else
+				slot(name) = Node::create(value);
+			return *this;
+		}
+
+		//Nested containers to rebind: doc.object("pos").set("x", x); doc.array<int>("ids").assign(...);
+		Object& object(std::string_view name) {
+			return child<Object>(name);
+		}
+
+		template<typename T>
+		Array<T>& array(std::string_view name) {
+			return child<Array<T>>(name);
+		}
+
+		void reserve(size_t count) {
+			if (count > children.capacity()) {
+				children.reserve(count);
+				index.reset();
+			}
+		}
+
+		//Moves the members of other into this object: only node ownership changes hands.
+		//With deep set, members that are Objects on both sides are merged recursively.
+		Object& merge(Object&& other, Conflict conflict = Conflict::Overwrite, bool deep = false) {
+			if (&other == this)
+				return *this;
+			if (conflict == Conflict::Throw)
+				checkConflicts(other, deep);
+			reserve(children.size() + other.children.size());
+			for (Entry& entry : other.children)
+				mergeEntry(std::move(entry.name), std::move(entry.node), true, conflict, deep);
+			other.clear();
+			return *this;
+		}
+
+		//Like merge(Object&&), but shares other's nodes instead of taking them.
+		Object& merge(const Object& other, Conflict conflict = Conflict::Overwrite, bool deep = false) {
+			if (conflict == Conflict::Throw)
+				checkConflicts(other, deep);
+			reserve(children.size() + other.children.size());
+			for (const Entry& entry : other.children)
+				mergeEntry(std::string(entry.name), std::shared_ptr<Node>(entry.node), false, conflict, deep);
+			return *this;
+		}
+
+		void clear() {
+			children.clear();
+			index.reset();
+			index.perfect.reset();
+		}
+
+		Ref find(std::string_view name) const {
+			Entry* entry = lookup(name);
+			return entry && entry->node ? entry->node->ref() : Ref();
+		}
+
+		//Builds a minimal perfect hash over the current names, so a lookup costs one hash
+		//and one name comparison. Adding a member unfreezes the object again.
+		void freeze() {
+			if (children.empty() || index.perfect)
+				return;
+			std::vector<uint64_t> hashes;
+			hashes.reserve(children.size());
+			for (const Entry& entry : children)
+				hashes.push_back(details::PerfectHash::hash(entry.name));
+			auto perfect = std::make_shared<details::PerfectHash>();
+			if (perfect->build(hashes))
+				index.perfect = std::move(perfect);
+		}
+
+		bool frozen() const {
+			return index.perfect != nullptr;
+		}
+
+		size_t size() const {
+			return children.size();
+		}
+
+		//Appends the object to out as a BSON document. Lengths are patched in once each
+		//document or array is complete, so the tree is walked only once.
+		void bson(std::string& out) const {
+			writeDocument(out);
+		}
+
+		std::string bson() const {
+			std::string out;
+			writeDocument(out);
+			return out;
+		}
+	};
+
+	//makeNode allocates the node behind the shared_ptr control block (a vtable pointer
+	//and two counts); the common containers must stay within the pool's size classes.
+	static_assert(sizeof(Object) + 2 * sizeof(void*) <= details::NodePool::largest, "Object nodes must be pooled");
+	static_assert(sizeof(Array<Object>) + 2 * sizeof(void*) <= details::NodePool::largest, "Array<Object> nodes must be pooled");
+
+#ifndef JSON_WRITER_EXTERNAL
+	JSON_WRITER_INLINE std::ostream& Object::write(std::ostream& os) const noexcept {
+		os << '{';
+		for (auto it = children.begin(); it != children.end(); ++it)
+		{
+			os << '\"' << it->name << "\":";
+			writeImpl(os, *it->node);
+			if (std::next(it) != children.end())
+				os << ',';
+		}
+		os << '}';
+
+		return os;
+	}
+
+	JSON_WRITER_INLINE void Object::writeDocument(std::string& out) const {
+		size_t start = details::bsonBegin(out);
+		for (const Entry& entry : children)
+			bsonImpl(out, entry.name, *entry.node);
+		details::bsonEnd(out, start);
+	}
+#endif
+
+	//String value of a StringPool, written from its cached escaped form.
+	class PooledString : public Node {
+	private:
+		std::string value;
+		std::string escaped;
+
+		virtual std::ostream& write(std::ostream& os) const noexcept override {
+			return os.write(escaped.data(), static_cast<std::streamsize>(escaped.size()));
+		}
+
+		virtual void writeBson(std::string& out, std::string_view key) const override {
+			details::bsonString(out, key, value);
+		}
+	public:
+		PooledString(std::string_view value)
+			:value(value) {
+			escaped.reserve(value.size() + 2);
+			details::appendEscaped(escaped, value.data(), value.size());
+		}
+
+		const std::string& get() const {
+			return value;
+		}
 
-	class Node;
-	template<typename T>
-	class Value;
-	class Object;
-	template<typename T>
-	class Array;
+		virtual Ref ref() const override {
+			return Ref(this, &value, &typeid(std::string));
+		}
+	};
 
-	class Node {
+	//Optional per-document dictionary of string values. Equal strings share one node,
+	//escaped once: root("status", pool("OK")). Not thread-safe.
+	class StringPool {
 	private:
-		virtual std::ostream& write(std::ostream& os) const noexcept = 0;
-	protected:
-		//------------WriterImpl---------------//
-		template<typename T>
-		inline static std::ostream& writeImpl(std::ostream& os, const T& value) noexcept {
-			return os << value;
+		std::unordered_map<std::string_view, std::shared_ptr<PooledString>> strings;
+	public:
+		std::shared_ptr<PooledString> operator()(std::string_view value) {
+			auto it = strings.find(value);
+			if (it != strings.end())
+				return it->second;
+			auto node = details::makeNode<PooledString>(value);
+			strings.emplace(node->get(), node);
+			return node;
 		}
 
-		inline static std::ostream& writeImpl(std::ostream& os, const std::tm& value) {
-			return os << '\"' << std::put_time(&value, "%Y-%m-%dT%H:%M:%S") << '\"';
+		size_t size() const {
+			return strings.size();
 		}
 
-		static std::ostream& writeImpl(std::ostream& os, const std::string& value) noexcept{
-			std::ostringstream escaped;
-			for (char ch : value) {
-				switch (ch) {
-				case '\"':
-				case '\\':
-				case '/':
-					escaped << '\\' << ch;
-					break;
-				default:
-					escaped << ch;
-				}
-			}
+		//Forgets the strings; documents still holding them keep them alive.
+		void clear() {
+			strings.clear();
+		}
+	};
+
+	//Pre-rendered JSON text spliced in verbatim. Minified fragments drop the whitespace
+	//outside strings while they are copied, so pretty-printed input stays compact.
+	//BSON output stores the text as a string element; it is not parsed.
+	class Raw : public Node {
+	private:
+		std::string json;
+		bool minify;
 
-			return os << '\"' << escaped.str() << '\"';
+		virtual std::ostream& write(std::ostream& os) const noexcept override {
+			if (!minify)
+				return os.write(json.data(), static_cast<std::streamsize>(json.size()));
+
+			std::string compact;
+			try {
+				compact.reserve(json.size());
+				details::appendMinified(compact, json.data(), json.size());
+			}
+			catch (...) {
+				os.setstate(std::ios_base::badbit);
+				return os;
+			}
+			return os.write(compact.data(), static_cast<std::streamsize>(compact.size()));
 		}
 	public:
-		friend std::ostream& operator<<(std::ostream& os, const Node& node) {
-			os.imbue(std::locale(os.getloc(),new details::DecimalPointFacet()));
-			return node.write(os);
+		Raw(std::string json, bool minify = false)
+			:json(std::move(json)), minify(minify) {}
+	};
+
+	//Union of several borrowed Objects, serialized without being built: a name present
+	//in more than one layer takes its value from the last one. Layers must outlive the view.
+	//Json::Overlay()(defaults)(overrides)(computed)
+	class Overlay : public Node {
+	private:
+		std::vector<const Object*> layers;
+
+		//Entries no higher layer overrides, in writing order. Shadowing is decided with a
+		//set of its own: writing leaves the layers' indexes alone, so layers shared with
+		//other threads can be written concurrently.
+		std::vector<const Object::Entry*> visible() const {
+			std::vector<const Object::Entry*> entries;
+			std::unordered_set<std::string_view> above;
+			for (size_t layer = layers.size(); layer-- > 0;) {
+				const auto& children = layers[layer]->children;
+				for (size_t i = children.size(); i-- > 0;)
+					if (!above.count(children[i].name))
+						entries.push_back(&children[i]);
+				for (const Object::Entry& entry : children)
+					above.insert(entry.name);
+			}
+			std::reverse(entries.begin(), entries.end());
+			return entries;
 		}
 
-		virtual ~Node() {};
+		virtual Ref child(std::string_view token, size_t) const override {
+			for (size_t layer = layers.size(); layer-- > 0;) {
+				Ref found = layers[layer]->find(token);
+				if (found)
+					return found;
+			}
+			return Ref();
+		}
 
-		template<typename T>
-		static std::shared_ptr<Node> create(const T& rval);
+		virtual std::ostream& write(std::ostream& os) const noexcept override {
+			os << '{';
+			bool first = true;
+			for (const Object::Entry* entry : visible()) {
+				if (!first)
+					os << ',';
+				first = false;
+				os << '\"' << entry->name << "\":";
+				writeImpl(os, *entry->node);
+			}
+			os << '}';
 
-		static std::shared_ptr<Node> create(const Object& rval);
+			return os;
+		}
 
-		static std::shared_ptr<Node> create(const char *rval);
+		void writeDocument(std::string& out) const {
+			size_t start = details::bsonBegin(out);
+			for (const Object::Entry* entry : visible())
+				bsonImpl(out, entry->name, *entry->node);
+			details::bsonEnd(out, start);
+		}
 
-		template<typename T>
-		static std::shared_ptr<Node> create(const std::initializer_list<T>& value);
+		virtual void writeBson(std::string& out, std::string_view key) const override {
+			details::bsonKey(out, details::BsonType::Document, key);
+			writeDocument(out);
+		}
+	public:
+		Overlay() {}
 
-		template<typename T>
-		static std::shared_ptr<Node> create(const std::vector<T>& value);
-	};
+		Overlay& operator()(const Object& layer) {
+			layers.push_back(&layer);
+			return *this;
+		}
 
+		void bson(std::string& out) const {
+			writeDocument(out);
+		}
 
-	template<typename T>
-	class Array : public Node {
+		std::string bson() const {
+			std::string out;
+			writeDocument(out);
+			return out;
+		}
+	};
+
+	//Array of objects sharing one schema: keys are stored and escaped once,
+	//values live in one vector per column.
+	//Json::Table<int, std::string> t({"id", "name"}); t(1, "a")(2, "b");
+	template<typename... Ts>
+	class Table : public Node {
 	private:
-		std::vector<T> children;
+		std::vector<std::string> keys;
+		std::vector<std::string> tokens;
+		std::tuple<std::vector<Ts>...> columns;
+
+		template<size_t... I>
+		Ref cell(size_t column, size_t row, std::index_sequence<I...>) const {
+			Ref result;
+			((I == column ? (result = cellAt<I>(row), 0) : 0), ...);
+			return result;
+		}
+
+		template<size_t I>
+		Ref cellAt(size_t row) const {
+			const auto& values = std::get<I>(columns);
+			if constexpr (std::is_same<typename std::decay_t<decltype(values)>::value_type, bool>::value)
+				return Ref();
+			else
+				return details::refTo(values[row]);
+		}
+
+		virtual Ref child(std::string_view token, size_t row) const override {
+			if (row == Ref::npos) {
+				size_t index;
+				if (!details::parseIndex(token, index) || index >= size())
+					return Ref();
+				return Ref(this, nullptr, nullptr, index);
+			}
+			for (size_t column = 0; column < keys.size(); ++column)
+				if (keys[column] == token)
+					return cell(column, row, std::index_sequence_for<Ts...>());
+			return Ref();
+		}
+
+		template<size_t... I>
+		void writeRow(std::ostream& os, size_t row, std::index_sequence<I...>) const {
+			((os.write(tokens[I].data(), tokens[I].size()), writeImpl(os, std::get<I>(columns)[row])), ...);
+		}
 
 		virtual std::ostream& write(std::ostream& os) const noexcept override {
 			os << '[';
-			for (auto it = children.begin(); it != children.end(); ++it) {
-				writeImpl(os, *it);
-				if (std::next(it) != children.end())
+			for (size_t row = 0, count = size(); row < count; ++row) {
+				if (row)
 					os << ',';
+				writeRow(os, row, std::index_sequence_for<Ts...>());
+				os << '}';
 			}
 			os << ']';
 
 			return os;
 		}
+
+		template<size_t... I>
+		void bsonRow(std::string& out, size_t row, std::index_sequence<I...>) const {
+			(bsonImpl(out, keys[I], std::get<I>(columns)[row]), ...);
+		}
+
+		virtual void writeBson(std::string& out, std::string_view key) const override {
+			details::bsonKey(out, details::BsonType::Array, key);
+			size_t start = details::bsonBegin(out);
+			char index[24];
+			for (size_t row = 0, count = size(); row < count; ++row) {
+				auto result = std::to_chars(index, index + sizeof(index), row);
+				details::bsonKey(out, details::BsonType::Document, std::string_view(index, static_cast<size_t>(result.ptr - index)));
+				size_t document = details::bsonBegin(out);
+				bsonRow(out, row, std::index_sequence_for<Ts...>());
+				details::bsonEnd(out, document);
+			}
+			details::bsonEnd(out, start);
+		}
+
+		template<size_t... I, typename... Us>
+		void push(std::index_sequence<I...>, Us&&... values) {
+			(std::get<I>(columns).push_back(std::forward<Us>(values)), ...);
+		}
 	public:
-		Array(const std::vector<T>& children)
-			:children(children) {}
+		Table(const std::vector<std::string>& keys)
+			:keys(keys) {
+			static_assert(sizeof...(Ts) > 0, "Table needs at least one column");
+			if (keys.size() != sizeof...(Ts))
+				throw std::invalid_argument("Table: number of keys does not match number of columns");
 
-		Array& operator()(T&& val) {
-			children.push_back(std::move(val));
+			for (size_t i = 0; i < keys.size(); ++i) {
+				std::ostringstream token;
+				token << (i ? ',' : '{');
+				writeImpl(token, keys[i]);
+				token << ':';
+				tokens.push_back(token.str());
+			}
+		}
+
+		template<typename... Us>
+		Table& operator()(Us&&... values) {
+			static_assert(sizeof...(Us) == sizeof...(Ts), "Table row must have one value per column");
+			push(std::index_sequence_for<Ts...>(), std::forward<Us>(values)...);
 			return *this;
 		}
-	};
 
-	template<typename T>
-	class Value : public Node {
-	private:
-		T value;
-	public:
-		Value(const T& value)
-			:value(value) {}
+		void reserve(size_t rows) {
+			std::apply([rows](auto&... column) { (column.reserve(rows), ...); }, columns);
+		}
 
-		virtual std::ostream& write(std::ostream& os) const noexcept override {
-			return writeImpl(os, value);
+		size_t size() const {
+			return std::get<0>(columns).size();
+		}
+
+		void clear() {
+			std::apply([](auto&... column) { (column.clear(), ...); }, columns);
 		}
 	};
 
-	class Object : public Node {
+	//Row-wise array of objects serialized straight from caller-owned column
+	//vectors, which must outlive serialization. Each column is formatted in
+	//one pass per block of rows and the rows are stitched from the fragments.
+	//Json::Columns c; c("id", ids)("region", codes, regionNames).parallel(8);
+	class Columns : public Node {
 	private:
-		std::unordered_map<std::string, std::shared_ptr<Node>> children;
+		struct Fragments {
+			std::string text;
+			std::vector<size_t> ends;
+		};
+
+		struct Column {
+			std::string name;
+			std::string token;
+			const std::type_info* type;
+			size_t stride;
+			const void* values;
+			std::vector<std::string> dictionary;
+			std::vector<std::string> labels;
+			void (*format)(const Column& column, size_t begin, size_t end, int precision, Fragments& out);
+			void (*encode)(const Column& column, size_t row, std::string& out);
+		};
+
+		static const size_t blockRows = 4096;
+
+		std::vector<Column> columns;
+		size_t rows = 0;
+		unsigned threads = 1;
+
+		template<typename T>
+		static void formatValues(const Column& column, size_t begin, size_t end, int precision, Fragments& out) {
+			const T* values = static_cast<const T*>(column.values);
+			for (size_t row = begin; row < end; ++row) {
+				if constexpr (std::is_same<T, std::string>::value) {
+					details::appendEscaped(out.text, values[row].data(), values[row].size());
+				}
+				else if constexpr (std::is_arithmetic<T>::value && !std::is_same<T, bool>::value && !std::is_same<T, char>::value) {
+					details::appendNumber(out.text, values[row], precision);
+				}
+				else {
+					std::ostringstream os;
+					os.imbue(std::locale(os.getloc(), new details::DecimalPointFacet()));
+					os.precision(precision);
+					writeImpl(os, values[row]);
+					out.text += os.str();
+				}
+				out.ends.push_back(out.text.size());
+			}
+		}
+
+		template<typename T>
+		static void formatCodes(const Column& column, size_t begin, size_t end, int, Fragments& out) {
+			const T* codes = static_cast<const T*>(column.values);
+			for (size_t row = begin; row < end; ++row) {
+				bool known = static_cast<size_t>(codes[row]) < column.dictionary.size();
+				if constexpr (std::is_signed<T>::value)
+					known = known && codes[row] >= 0;
+				if (known)
+					out.text += column.dictionary[static_cast<size_t>(codes[row])];
+				else
+					out.text += "null";
+				out.ends.push_back(out.text.size());
+			}
+		}
+
+		template<typename T>
+		static void encodeValue(const Column& column, size_t row, std::string& out) {
+			bsonImpl(out, column.name, static_cast<const T*>(column.values)[row]);
+		}
+
+		template<typename T>
+		static void encodeCode(const Column& column, size_t row, std::string& out) {
+			T code = static_cast<const T*>(column.values)[row];
+			bool known = static_cast<size_t>(code) < column.labels.size();
+			if constexpr (std::is_signed<T>::value)
+				known = known && code >= 0;
+			if (known)
+				details::bsonString(out, column.name, column.labels[static_cast<size_t>(code)]);
+			else
+				details::bsonKey(out, details::BsonType::Null, column.name);
+		}
+
+		void setRows(size_t count) {
+			if (!columns.empty() && count != rows)
+				throw std::invalid_argument("Columns: all columns must have the same number of rows");
+			rows = count;
+		}
+
+		template<typename T>
+		void addColumn(const std::string& name, const T* values, void (*format)(const Column&, size_t, size_t, int, Fragments&),
+			void (*encode)(const Column&, size_t, std::string&)) {
+			Column column;
+			column.name = name;
+			column.type = &typeid(T);
+			column.stride = sizeof(T);
+			column.token += columns.empty() ? '{' : ',';
+			details::appendEscaped(column.token, name.data(), name.size());
+			column.token += ':';
+			column.values = values;
+			column.format = format;
+			column.encode = encode;
+			columns.push_back(std::move(column));
+		}
+
+		virtual Ref child(std::string_view token, size_t row) const override {
+			if (row == Ref::npos) {
+				size_t index;
+				if (!details::parseIndex(token, index) || index >= rows || columns.empty())
+					return Ref();
+				return Ref(this, nullptr, nullptr, index);
+			}
+			for (const Column& column : columns)
+				if (column.name == token)
+					return Ref(nullptr, static_cast<const char*>(column.values) + row * column.stride, column.type);
+			return Ref();
+		}
+
+		void writeRows(size_t begin, size_t end, int precision, std::vector<Fragments>& scratch, std::string& out) const {
+			for (size_t block = begin; block < end; block += blockRows) {
+				size_t blockEnd = end - block < blockRows ? end : block + blockRows;
+				for (size_t c = 0; c < columns.size(); ++c) {
+					scratch[c].text.clear();
+					scratch[c].ends.clear();
+					columns[c].format(columns[c], block, blockEnd, precision, scratch[c]);
+				}
+				for (size_t row = 0; row < blockEnd - block; ++row) {
+					if (block + row)
+						out += ',';
+					for (size_t c = 0; c < columns.size(); ++c) {
+						size_t from = row ? scratch[c].ends[row - 1] : 0;
+						out += columns[c].token;
+						out.append(scratch[c].text, from, scratch[c].ends[row] - from);
+					}
+					out += '}';
+				}
+			}
+		}
 
 		virtual std::ostream& write(std::ostream& os) const noexcept override {
-			os << '{';
-			for (auto it = children.begin(); it != children.end(); ++it)
-			{
-				os << '\"' << it->first << "\":" << *it->second;
-				if (std::next(it) != children.end())
-					os << ',';
+			os << '[';
+			if (!columns.empty()) {
+				int precision = static_cast<int>(os.precision());
+				unsigned workers = threads;
+				if (workers > rows / blockRows)
+					workers = static_cast<unsigned>(rows / blockRows);
+
+				std::vector<std::string> parts(workers > 1 ? workers : 1);
+				try {
+					if (workers > 1) {
+						//Workers report failures through the flag; threads already started are
+						//joined even when starting the next one throws.
+						std::atomic<bool> failed(false);
+						std::vector<std::thread> pool;
+						pool.reserve(workers);
+						size_t step = (rows + workers - 1) / workers;
+						try {
+							for (unsigned w = 0; w < workers; ++w) {
+								pool.emplace_back([this, w, step, precision, &parts, &failed]() {
+									try {
+										std::vector<Fragments> scratch(columns.size());
+										size_t begin = w * step;
+										writeRows(begin, begin + step < rows ? begin + step : rows, precision, scratch, parts[w]);
+									}
+									catch (...) {
+										failed = true;
+									}
+								});
+							}
+						}
+						catch (...) {
+							failed = true;
+						}
+						for (auto& thread : pool)
+							thread.join();
+						if (failed)
+							os.setstate(std::ios_base::badbit);
+						else
+							for (auto& part : parts)
+								os.write(part.data(), static_cast<std::streamsize>(part.size()));
+					}
+					else {
+						std::vector<Fragments> scratch(columns.size());
+						for (size_t block = 0; block < rows; block += blockRows) {
+							parts[0].clear();
+							writeRows(block, rows - block < blockRows ? rows : block + blockRows, precision, scratch, parts[0]);
+							os.write(parts[0].data(), static_cast<std::streamsize>(parts[0].size()));
+						}
+					}
+				}
+				catch (...) {
+					os.setstate(std::ios_base::badbit);
+				}
 			}
-			os << '}';
+			os << ']';
 
 			return os;
 		}
+
+		virtual void writeBson(std::string& out, std::string_view key) const override {
+			details::bsonKey(out, details::BsonType::Array, key);
+			size_t start = details::bsonBegin(out);
+			if (!columns.empty()) {
+				char index[24];
+				for (size_t row = 0; row < rows; ++row) {
+					auto result = std::to_chars(index, index + sizeof(index), row);
+					details::bsonKey(out, details::BsonType::Document, std::string_view(index, static_cast<size_t>(result.ptr - index)));
+					size_t document = details::bsonBegin(out);
+					for (const Column& column : columns)
+						column.encode(column, row, out);
+					details::bsonEnd(out, document);
+				}
+			}
+			details::bsonEnd(out, start);
+		}
 	public:
-		Object() {}
+		Columns() {}
+
+		template<typename T>
+		Columns& operator()(const std::string& name, const T* values, size_t count) {
+			setRows(count);
+			addColumn(name, values, &formatValues<T>, &encodeValue<T>);
+			return *this;
+		}
+
+		template<typename T>
+		Columns& operator()(const std::string& name, const std::vector<T>& values) {
+			return (*this)(name, values.data(), values.size());
+		}
+
+		template<typename T>
+		Columns& operator()(const std::string& name, std::vector<T>&& values) = delete;
 
+		//Dictionary-encoded strings; every dictionary entry is escaped once.
 		template<typename T>
-		Object& operator()(const std::string& name, const T& value) {
-			children[name] = Node::create(value);
+		Columns& operator()(const std::string& name, const T* codes, size_t count, const std::vector<std::string>& dictionary) {
+			static_assert(std::is_integral<T>::value, "dictionary codes must be integers");
+			setRows(count);
+			addColumn(name, codes, &formatCodes<T>, &encodeCode<T>);
+			for (const auto& entry : dictionary) {
+				std::string token;
+				details::appendEscaped(token, entry.data(), entry.size());
+				columns.back().dictionary.push_back(std::move(token));
+			}
+			columns.back().labels = dictionary;
 			return *this;
 		}
 
 		template<typename T>
-		Object& operator()(const std::string& name, const std::initializer_list<T>& value) {
-			children[name] = Node::create(value);
+		Columns& operator()(const std::string& name, const std::vector<T>& codes, const std::vector<std::string>& dictionary) {
+			return (*this)(name, codes.data(), codes.size(), dictionary);
+		}
+
+		//Formats large results on up to `count` threads, one contiguous row range each.
+		Columns& parallel(unsigned count) {
+			threads = count ? count : 1;
 			return *this;
 		}
+
+		size_t size() const {
+			return rows;
+		}
 	};
 
-	template<typename T>
-	inline std::shared_ptr<Node> Node::create(const T& rval) {
-		return std::make_shared<Value<T>>(rval);
+	template<typename... Fields>
+	class StaticObject;
+	template<typename... Ts>
+	class StaticArray;
+
+	namespace details
+	{
+		//Type a make_object/make_array argument is kept as: C strings become views, so
+		//building a static document copies no characters.
+		template<typename T>
+		using StaticStored = typename std::conditional<std::is_same<std::decay_t<T>, const char*>::value
+			|| std::is_same<std::decay_t<T>, char*>::value, std::string_view, std::decay_t<T>>::type;
+
+		//Type a make_object name is kept as: a temporary std::string is moved in and
+		//owned by the member, anything else is viewed.
+		template<typename A>
+		using StaticName = typename std::conditional<std::is_same<A, std::string&&>::value
+			|| std::is_same<A, std::string>::value, std::string, std::string_view>::type;
+
+		template<typename T, typename Name = std::string_view>
+		struct StaticField {
+			typedef T value_type;
+
+			Name name;
+			T value;
+		};
+
+		template<typename T>
+		struct IsStatic : std::false_type {};
+
+		template<typename... Ts>
+		struct IsStatic<StaticObject<Ts...>> : std::true_type {};
+
+		template<typename... Ts>
+		struct IsStatic<StaticArray<Ts...>> : std::true_type {};
+
+		//Whether writing T relies on the stream's decimal point, i.e. on operator<< of a
+		//double; the static writer formats its own numbers and strings.
+		template<typename T>
+		struct NeedsLocale : std::integral_constant<bool, !std::is_arithmetic<T>::value && !std::is_enum<T>::value
+			&& !std::is_same<T, std::string>::value && !std::is_same<T, std::string_view>::value> {};
+
+		template<typename... Fields>
+		struct NeedsLocale<StaticObject<Fields...>> : std::disjunction<NeedsLocale<typename Fields::value_type>...> {};
+
+		template<typename... Ts>
+		struct NeedsLocale<StaticArray<Ts...>> : std::disjunction<NeedsLocale<Ts>...> {};
+
+		struct StaticWriter {
+			template<typename T>
+			static void write(std::ostream& os, const T& value) noexcept {
+				if constexpr (IsStatic<T>::value)
+					value.write(os);
+				else if constexpr (std::is_same<T, std::string>::value || std::is_same<T, std::string_view>::value)
+					writeEscaped(os, value.data(), value.size());
+				else if constexpr (std::is_floating_point<T>::value) {
+					char buffer[64];
+					auto result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::general, static_cast<int>(os.precision()));
+					os.write(buffer, result.ptr - buffer);
+				}
+				else
+					Node::writeImpl(os, value);
+			}
+
+			//Root of a static document: same probes and locale as Node's operator<<,
+			//except that the locale is only imbued when some member needs it.
+			template<typename T>
+			static std::ostream& document(std::ostream& os, const T& value) noexcept {
+				JSON_WRITER_PROBE2(document__begin, &value, os.rdbuf());
+				if constexpr (NeedsLocale<T>::value)
+					os.imbue(std::locale(os.getloc(), new DecimalPointFacet()));
+				value.write(os);
+				JSON_WRITER_PROBE3(document__end, &value, os.rdbuf(), os.fail());
+				return os;
+			}
+		};
+
+		template<typename T>
+		inline auto toDynamic(const T& value) {
+			if constexpr (std::is_same<T, std::string_view>::value)
+				return std::string(value);
+			else if constexpr (IsStatic<T>::value)
+				return value.toDynamic();
+			else
+				return value;
+		}
+
+		template<typename T>
+		using DynamicOf = decltype(toDynamic(std::declval<const T&>()));
+
+		//Member I of make_object's forwarded arguments.
+		template<typename Tuple, size_t I>
+		using StaticFieldAt = StaticField<StaticStored<std::tuple_element_t<2 * I + 1, Tuple>>, StaticName<std::tuple_element_t<2 * I, Tuple>>>;
+
+		template<typename Tuple, size_t... I>
+		inline auto makeObject(Tuple&& args, std::index_sequence<I...>) {
+			using Arguments = std::decay_t<Tuple>;
+			return StaticObject<StaticFieldAt<Arguments, I>...>(StaticFieldAt<Arguments, I>{
+				StaticName<std::tuple_element_t<2 * I, Arguments>>(std::get<2 * I>(std::move(args))), std::get<2 * I + 1>(std::move(args)) }...);
+		}
+	}
+
+	//Object with a fixed set of members, as built by make_object. The members are held
+	//in a tuple inside the object and written by inlined code, without heap allocations
+	//or virtual calls. Names given as temporary std::strings are owned by the object;
+	//other names and C string values are kept as views and must outlive it.
+	template<typename... Fields>
+	class StaticObject {
+	private:
+		std::tuple<Fields...> fields;
+
+		friend struct details::StaticWriter;
+
+		template<typename Field>
+		static void writeField(std::ostream& os, const Field& field, bool first) noexcept {
+			os.write(first ? "\"" : ",\"", first ? 1 : 2);
+			os.write(field.name.data(), static_cast<std::streamsize>(field.name.size()));
+			os.write("\":", 2);
+			details::StaticWriter::write(os, field.value);
+		}
+
+		template<size_t... I>
+		void write(std::ostream& os, std::index_sequence<I...>) const noexcept {
+			os.put('{');
+			(writeField(os, std::get<I>(fields), I == 0), ...);
+			os.put('}');
+		}
+
+		void write(std::ostream& os) const noexcept {
+			write(os, std::index_sequence_for<Fields...>());
+		}
+
+		template<size_t... I>
+		Object toObject(std::index_sequence<I...>) const {
+			Object object;
+			object.reserve(sizeof...(Fields));
+			(object(std::string(std::get<I>(fields).name), details::toDynamic(std::get<I>(fields).value)), ...);
+			return object;
+		}
+	public:
+		explicit StaticObject(Fields... fields)
+			:fields(std::move(fields)...) {}
+
+		friend std::ostream& operator<<(std::ostream& os, const StaticObject& object) {
+			return details::StaticWriter::document(os, object);
+		}
+
+		//Copies the members into a dynamic Object, nested static documents included.
+		Object toObject() const {
+			return toObject(std::index_sequence_for<Fields...>());
+		}
+
+		Object toDynamic() const {
+			return toObject();
+		}
+
+		operator Object() const {
+			return toObject();
+		}
 	};
 
-	inline std::shared_ptr<Node> Node::create(const Object& rval) {
-		return std::make_shared<Object>(rval);
+	//Array with a fixed list of elements, possibly of different types, as built by make_array.
+	template<typename... Ts>
+	class StaticArray {
+	private:
+		std::tuple<Ts...> values;
+
+		friend struct details::StaticWriter;
+
+		//Elements that all convert to one type form an Array of that type; mixed ones
+		//an Array of nodes.
+		static constexpr bool uniform = sizeof...(Ts) > 0
+			&& std::conjunction<std::is_same<details::DynamicOf<Ts>, details::DynamicOf<std::tuple_element_t<0, std::tuple<Ts..., int>>>>...>::value;
+	public:
+		using Dynamic = Array<typename std::conditional<uniform, details::DynamicOf<std::tuple_element_t<0, std::tuple<Ts..., int>>>, std::shared_ptr<Node>>::type>;
+	private:
+		template<typename T>
+		static void writeElement(std::ostream& os, const T& value, bool first) noexcept {
+			if (!first)
+				os.put(',');
+			details::StaticWriter::write(os, value);
+		}
+
+		template<size_t... I>
+		void write(std::ostream& os, std::index_sequence<I...>) const noexcept {
+			os.put('[');
+			(writeElement(os, std::get<I>(values), I == 0), ...);
+			os.put(']');
+		}
+
+		void write(std::ostream& os) const noexcept {
+			write(os, std::index_sequence_for<Ts...>());
+		}
+
+		template<size_t... I>
+		Dynamic toArray(std::index_sequence<I...>) const {
+			Dynamic array;
+			array.reserve(sizeof...(Ts));
+			if constexpr (uniform)
+				(array(details::toDynamic(std::get<I>(values))), ...);
+			else
+				(array(Node::create(details::toDynamic(std::get<I>(values)))), ...);
+			return array;
+		}
+	public:
+		explicit StaticArray(Ts... values)
+			:values(std::move(values)...) {}
+
+		friend std::ostream& operator<<(std::ostream& os, const StaticArray& array) {
+			return details::StaticWriter::document(os, array);
+		}
+
+		//Copies the elements into a dynamic Array; see Dynamic for its element type.
+		Dynamic toArray() const {
+			return toArray(std::index_sequence_for<Ts...>());
+		}
+
+		Dynamic toDynamic() const {
+			return toArray();
+		}
+
+		operator Dynamic() const {
+			return toArray();
+		}
 	};
 
-	inline std::shared_ptr<Node> Node::create(const char* rval) {
-		return std::make_shared<Value<std::string>>(rval);
+	//Json::make_object("id", 7, "name", "disk", "load", Json::make_array(0.5, 0.25))
+	template<typename... Args>
+	inline auto make_object(Args&&... args) {
+		static_assert(sizeof...(Args) % 2 == 0, "make_object takes name, value pairs");
+		return details::makeObject(std::forward_as_tuple(std::forward<Args>(args)...), std::make_index_sequence<sizeof...(Args) / 2>());
+	}
+
+	template<typename... Args>
+	inline StaticArray<details::StaticStored<Args>...> make_array(Args&&... args) {
+		return StaticArray<details::StaticStored<Args>...>(details::StaticStored<Args>(std::forward<Args>(args))...);
 	}
 
 	template<typename T>
-	inline std::shared_ptr<Node> Node::create(const std::initializer_list<T>& value) {
-		return std::make_shared<Array<T>>(value);
+	inline const T* Ref::as() const {
+		if constexpr (std::is_base_of<Node, T>::value)
+			return row == npos ? dynamic_cast<const T*>(node) : nullptr;
+		else
+			return type && *type == typeid(T) ? static_cast<const T*>(leaf) : nullptr;
+	}
+
+#ifndef JSON_WRITER_EXTERNAL
+	JSON_WRITER_INLINE Ref Ref::operator[](std::string_view name) const {
+		return node ? node->child(name, row) : Ref();
+	}
+
+	JSON_WRITER_INLINE Ref Ref::operator[](size_t index) const {
+		char digits[24];
+		auto result = std::to_chars(digits, digits + sizeof(digits), index);
+		return (*this)[std::string_view(digits, static_cast<size_t>(result.ptr - digits))];
+	}
+
+	JSON_WRITER_INLINE Ref Ref::pointer(std::string_view path) const {
+		if (path.empty())
+			return *this;
+		if (path[0] != '/')
+			return Ref();
+
+		Ref current = *this;
+		std::string unescaped;
+		while (current && !path.empty()) {
+			path.remove_prefix(1);
+			size_t end = path.find('/');
+			std::string_view token = path.substr(0, end);
+			path = end == std::string_view::npos ? std::string_view() : path.substr(end);
+			if (token.find('~') != std::string_view::npos) {
+				unescaped.clear();
+				for (size_t i = 0; i < token.size(); ++i) {
+					if (token[i] == '~' && i + 1 < token.size() && (token[i + 1] == '0' || token[i + 1] == '1'))
+						unescaped += token[++i] == '0' ? '~' : '/';
+					else
+						unescaped += token[i];
+				}
+				token = unescaped;
+			}
+			current = current[token];
+		}
+		return current;
 	}
+#endif
 
 	template<typename T>
-	inline std::shared_ptr<Node> Node::create(const std::vector<T>& value) {
-		return std::make_shared<Array<T>>(value);
+	inline std::shared_ptr<Node> Node::create(T&& rval) {
+		using Type = std::decay_t<T>;
+		if constexpr (std::is_base_of<Node, Type>::value)
+			return details::makeNode<Type>(std::forward<T>(rval));
+		else if constexpr (details::IsNodePointer<Type>::value)
+			return std::shared_ptr<Node>(std::forward<T>(rval));
+		else if constexpr (details::IsStatic<Type>::value)
+			return details::makeNode<details::DynamicOf<Type>>(rval.toDynamic());
+		else if constexpr (details::IsVector<Type>::value)
+			return details::makeNode<Array<details::Stored<typename Type::value_type>>>(std::forward<T>(rval));
+		else
+			return details::makeNode<Value<details::Stored<T>>>(std::forward<T>(rval));
+	};
+
+	template<typename T>
+	inline std::shared_ptr<Node> Node::create(std::initializer_list<T> value) {
+		return details::makeNode<Array<details::Stored<T>>>(value.begin(), value.end());
 	}
+
+#ifdef JSON_WRITER_EXTERNAL
+	extern template class Value<int>;
+	extern template class Value<unsigned>;
+	extern template class Value<long long>;
+	extern template class Value<double>;
+	extern template class Value<bool>;
+	extern template class Value<std::string>;
+	extern template class Array<int>;
+	extern template class Array<long long>;
+	extern template class Array<double>;
+	extern template class Array<std::string>;
+	extern template class Array<Object>;
+	extern template std::shared_ptr<Node> Node::create<int>(int&&);
+	extern template std::shared_ptr<Node> Node::create<int&>(int&);
+	extern template std::shared_ptr<Node> Node::create<double>(double&&);
+	extern template std::shared_ptr<Node> Node::create<double&>(double&);
+	extern template std::shared_ptr<Node> Node::create<bool>(bool&&);
+	extern template std::shared_ptr<Node> Node::create<std::string>(std::string&&);
+	extern template std::shared_ptr<Node> Node::create<std::string&>(std::string&);
+	extern template std::shared_ptr<Node> Node::create<const std::string&>(const std::string&);
+	extern template std::shared_ptr<Node> Node::create<Object>(Object&&);
+	extern template std::shared_ptr<Node> Node::create<int>(std::initializer_list<int>);
+	extern template std::shared_ptr<Node> Node::create<double>(std::initializer_list<double>);
+	extern template std::shared_ptr<Node> Node::create<const char*>(std::initializer_list<const char*>);
+	extern template std::shared_ptr<Node> Node::create<Object>(std::initializer_list<Object>);
+#endif
 }
 
 
@@ -219,6 +2717,9 @@ int main()
 			("refVal", refval));
 	}
 	root("refObjArr", jsonVect);
+	root("table", Json::Table<int, std::string>({ "id", "name" })
+		(1, "first")
+		(2, "second"));
 	std::time_t t = std::time(0);   // get time now
 	std::tm dt;
 	localtime_s(&dt,&t);
@@ -0,0 +1,100 @@
+//Multi-threaded build-and-destroy throughput of Json::Object trees.
+//  g++ -O2 -std=c++17 -pthread -I.. AllocBench.cpp -o AllocBench
+//  g++ -O2 -std=c++17 -pthread -I.. -DJSON_WRITER_NO_POOL AllocBench.cpp -o AllocBenchNoPool
+//Usage: AllocBench [maxThreads] [secondsPerRun]
+//"local" builds and destroys on the same thread, "handoff" destroys every
+//document on the neighbouring thread, exercising the cross-thread return path.
+#include "../JsonWriter.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+
+namespace
+{
+	const size_t nodesPerDocument = 14;
+
+	Json::Object buildDocument(int seed) {
+		return Json::Object()
+			("id", seed)
+			("name", "event")
+			("source", "collector-eu-west")
+			("value", seed * 0.5)
+			("count", seed % 17)
+			("tags", { "a", "b", "c" })
+			("samples", { 1, 2, 3, 4 })
+			("origin", Json::Object()
+				("x", seed)
+				("y", -seed)
+				("z", 0))
+			("status", 200);
+	}
+
+	struct Mailbox {
+		std::mutex mutex;
+		std::deque<std::vector<Json::Object>> batches;
+	};
+
+	double run(unsigned threads, bool handoff, double seconds) {
+		std::atomic<bool> stop(false);
+		std::atomic<unsigned long long> built(0);
+		std::vector<Mailbox> mailboxes(threads);
+		std::vector<std::thread> workers;
+
+		for (unsigned t = 0; t < threads; ++t) {
+			workers.emplace_back([&, t]() {
+				unsigned long long count = 0;
+				std::vector<Json::Object> batch;
+				Mailbox& mine = mailboxes[t];
+				Mailbox& next = mailboxes[(t + 1) % threads];
+				while (!stop.load(std::memory_order_relaxed)) {
+					batch.push_back(buildDocument(static_cast<int>(count++)));
+					if (batch.size() < 64)
+						continue;
+					if (handoff) {
+						{
+							std::lock_guard<std::mutex> lock(next.mutex);
+							next.batches.push_back(std::move(batch));
+						}
+						std::deque<std::vector<Json::Object>> received;
+						{
+							std::lock_guard<std::mutex> lock(mine.mutex);
+							received.swap(mine.batches);
+						}
+					}
+					batch.clear();
+				}
+				built += count;
+			});
+		}
+
+		std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+		stop = true;
+		for (auto& worker : workers)
+			worker.join();
+		return static_cast<double>(built.load()) / seconds;
+	}
+}
+
+int main(int argc, char** argv) {
+	unsigned maxThreads = argc > 1 ? static_cast<unsigned>(std::atoi(argv[1])) : std::thread::hardware_concurrency();
+	double seconds = argc > 2 ? std::atof(argv[2]) : 1.0;
+	if (maxThreads == 0)
+		maxThreads = 1;
+
+#ifdef JSON_WRITER_NO_POOL
+	std::printf("allocator: make_shared\n");
+#else
+	std::printf("allocator: node pool\n");
+#endif
+	std::printf("%8s %8s %14s %14s\n", "threads", "mode", "docs/s", "nodes/s");
+	for (unsigned threads = 1;; threads = threads * 2 < maxThreads ? threads * 2 : maxThreads) {
+		for (bool handoff : { false, true }) {
+			double rate = run(threads, handoff, seconds);
+			std::printf("%8u %8s %14.0f %14.0f\n", threads, handoff ? "handoff" : "local", rate, rate * nodesPerDocument);
+		}
+		if (threads == maxThreads)
+			break;
+	}
+	return 0;
+}
@@ -0,0 +1,41 @@
+//Group-commit throughput of Json::DurableLog: producers append records and block until
+//each one is durable.
+//  g++ -O2 -std=c++17 -pthread -I.. DurableBench.cpp -o DurableBench
+//Usage: DurableBench [path] [producers] [recordsPerProducer] [maxLatencyMicros] [maxRecords]
+#include "../JsonFile.h"
+#include <cstdio>
+#include <cstdlib>
+
+int main(int argc, char** argv) {
+	const char* path = argc > 1 ? argv[1] : "DurableBench.ndjson";
+	unsigned producers = argc > 2 ? static_cast<unsigned>(std::atoi(argv[2])) : 32;
+	int records = argc > 3 ? std::atoi(argv[3]) : 200;
+	std::chrono::microseconds latency(argc > 4 ? std::atoi(argv[4]) : 0);
+	size_t maxRecords = argc > 5 ? static_cast<size_t>(std::atoi(argv[5])) : 64;
+	if (producers == 0)
+		producers = 1;
+
+	Json::DurableLog::Stats stats;
+	auto begin = std::chrono::steady_clock::now();
+	{
+		Json::DurableLog log(path, Json::BatchPolicy(maxRecords, 1 << 20, latency));
+		std::vector<std::thread> threads;
+		for (unsigned p = 0; p < producers; ++p) {
+			threads.emplace_back([&log, p, records]() {
+				for (int i = 0; i < records; ++i)
+					log.append(Json::Object()("producer", p)("sequence", i)("action", "transfer")("amount", i * 0.01));
+			});
+		}
+		for (auto& thread : threads)
+			thread.join();
+		stats = log.stats();
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+	std::printf("records/s        %12.0f\n", static_cast<double>(stats.records) / seconds);
+	std::printf("groups           %12llu\n", stats.groups);
+	std::printf("records/group    %12.1f (max %zu)\n", stats.groups ? static_cast<double>(stats.records) / static_cast<double>(stats.groups) : 0.0, stats.maxGroup);
+	std::printf("commit avg us    %12.1f\n", stats.groups ? std::chrono::duration<double, std::micro>(stats.commitTime).count() / static_cast<double>(stats.groups) : 0.0);
+	std::printf("commit max us    %12.1f\n", std::chrono::duration<double, std::micro>(stats.maxCommit).count());
+	return 0;
+}
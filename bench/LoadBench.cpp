@@ -0,0 +1,127 @@
+//End-to-end load: N threads build event documents and serialize each one to a sink.
+//  g++ -O2 -std=c++17 -pthread -I.. LoadBench.cpp -o LoadBench
+//  g++ -O2 -std=c++17 -pthread -I.. -DJSON_WRITER_NO_POOL LoadBench.cpp -o LoadBenchNoPool
+//Usage: LoadBench [maxThreads] [secondsPerRun]
+//Thread counts double up to maxThreads (32 by default). Every document shares
+//one host object across all threads, so its reference count is contended the
+//way a process-wide context would be. Latency covers build plus serialization.
+#include "../JsonWriter.h"
+#include "../JsonSink.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+namespace
+{
+	//One per thread, each on its own cache line so counting never shares one.
+	struct alignas(64) Result {
+		double documents = 0;
+		std::vector<double> latencies;
+	};
+
+	std::shared_ptr<Json::Object> makeHost() {
+		auto host = std::make_shared<Json::Object>();
+		(*host)("name", "ingest-07")("region", "eu-west-1")("version", "4.2.1")("pid", 4711);
+		return host;
+	}
+
+	Json::Object buildEvent(const std::shared_ptr<Json::Object>& host, unsigned thread, unsigned long long sequence) {
+		Json::Object event;
+		event("sequence", sequence)
+			("thread", thread)
+			("time", std::chrono::system_clock::now())
+			("level", sequence % 10 == 0 ? "warn" : "info")
+			("message", "request completed for /api/v2/orders/" + std::to_string(sequence % 1000))
+			("host", host)
+			("http", Json::Object()
+				("method", "GET")
+				("status", sequence % 50 == 0 ? 500 : 200)
+				("bytes", static_cast<long long>(sequence * 37 % 65536))
+				("durationMs", static_cast<double>(sequence % 977) / 10))
+			("tags", { "api", "orders", "v2" })
+			("spans", { 12, 3, 48, 7 });
+		return event;
+	}
+
+	double percentile(const std::vector<double>& sorted, double fraction) {
+		if (sorted.empty())
+			return 0;
+		size_t index = static_cast<size_t>(fraction * static_cast<double>(sorted.size() - 1));
+		return sorted[index];
+	}
+
+	Result run(unsigned threads, double seconds, int devNull) {
+		std::shared_ptr<Json::Object> host = makeHost();
+		std::atomic<bool> stop(false);
+		std::vector<Result> results(threads);
+		std::vector<std::thread> workers;
+
+		for (unsigned t = 0; t < threads; ++t) {
+			workers.emplace_back([&, t]() {
+				Result& mine = results[t];
+				mine.latencies.reserve(1 << 20);
+				Json::FdSink sink(devNull);
+				std::ostream os(&sink);
+				unsigned long long sequence = 0;
+				while (!stop.load(std::memory_order_relaxed)) {
+					auto begin = std::chrono::steady_clock::now();
+					Json::Object event = buildEvent(host, t, sequence++);
+					os << event << '\n';
+					auto end = std::chrono::steady_clock::now();
+					mine.latencies.push_back(std::chrono::duration<double, std::micro>(end - begin).count());
+				}
+				os.flush();
+				mine.documents = static_cast<double>(sequence);
+			});
+		}
+
+		std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+		stop = true;
+		for (auto& worker : workers)
+			worker.join();
+
+		Result total;
+		for (Result& result : results) {
+			total.documents += result.documents;
+			total.latencies.insert(total.latencies.end(), result.latencies.begin(), result.latencies.end());
+		}
+		return total;
+	}
+}
+
+int main(int argc, char** argv) {
+	unsigned maxThreads = argc > 1 ? static_cast<unsigned>(std::atoi(argv[1])) : 32;
+	double seconds = argc > 2 ? std::atof(argv[2]) : 2.0;
+	if (maxThreads == 0)
+		maxThreads = 1;
+
+	int devNull = ::open("/dev/null", O_WRONLY | O_CLOEXEC);
+	if (devNull < 0) {
+		std::perror("/dev/null");
+		return 1;
+	}
+
+	//One serialized event, to turn documents into bytes.
+	std::ostringstream sample;
+	sample << buildEvent(makeHost(), 0, 1) << '\n';
+	double documentBytes = static_cast<double>(sample.str().size());
+
+#ifdef JSON_WRITER_NO_POOL
+	std::printf("allocator: make_shared\n");
+#else
+	std::printf("allocator: node pool\n");
+#endif
+	std::printf("%8s %12s %10s %10s %10s %10s %10s\n", "threads", "docs/s", "MB/s", "p50 us", "p99 us", "p99.9 us", "max us");
+	for (unsigned threads = 1;; threads = threads * 2 < maxThreads ? threads * 2 : maxThreads) {
+		Result result = run(threads, seconds, devNull);
+		std::sort(result.latencies.begin(), result.latencies.end());
+		double rate = result.documents / seconds;
+		std::printf("%8u %12.0f %10.1f %10.2f %10.2f %10.2f %10.2f\n", threads, rate, rate * documentBytes / 1e6,
+			percentile(result.latencies, 0.5), percentile(result.latencies, 0.99), percentile(result.latencies, 0.999),
+			result.latencies.empty() ? 0.0 : result.latencies.back());
+		if (threads == maxThreads)
+			break;
+	}
+	::close(devNull);
+	return 0;
+}
@@ -0,0 +1,137 @@
+#ifndef PerfCountersH
+#define PerfCountersH
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+//Hardware counters around a measured region, read through perf_event_open.
+//Counters the kernel refuses (perf_event_paranoid, containers, VMs without a PMU)
+//are reported as unavailable and the benchmark falls back to wall-clock time.
+//Every counter is opened on its own so one missing event does not hide the others.
+class PerfCounters {
+public:
+	enum Event {
+		Cycles,
+		Instructions,
+		BranchMisses,
+		L1Misses,
+		LlcMisses,
+		EventCount
+	};
+
+	struct Sample {
+		double values[EventCount];
+		bool valid[EventCount];
+
+		//Instructions per cycle; zero when either counter is missing.
+		double ipc() const {
+			return valid[Cycles] && valid[Instructions] && values[Cycles] > 0 ? values[Instructions] / values[Cycles] : 0;
+		}
+	};
+private:
+	int fds[EventCount];
+	std::string reason;
+
+#if defined(__linux__)
+	static int open(uint32_t type, uint64_t config) {
+		perf_event_attr attr;
+		std::memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = type;
+		attr.config = config;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+	}
+
+	static uint64_t cacheMiss(uint64_t cache) {
+		return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+	}
+#endif
+public:
+	PerfCounters() {
+		for (int& fd : fds)
+			fd = -1;
+#if defined(__linux__)
+		fds[Cycles] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+		if (fds[Cycles] < 0)
+			reason = std::strerror(errno);
+		fds[Instructions] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+		fds[BranchMisses] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+		fds[L1Misses] = open(PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_L1D));
+		fds[LlcMisses] = open(PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_LL));
+#else
+		reason = "perf_event_open is Linux only";
+#endif
+	}
+
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	~PerfCounters() {
+#if defined(__linux__)
+		for (int fd : fds)
+			if (fd >= 0)
+				::close(fd);
+#endif
+	}
+
+	bool available(Event event) const {
+		return fds[event] >= 0;
+	}
+
+	bool any() const {
+		for (int fd : fds)
+			if (fd >= 0)
+				return true;
+		return false;
+	}
+
+	//Why the cycle counter could not be opened, empty when it works.
+	const std::string& unavailableReason() const {
+		return reason;
+	}
+
+	void start() {
+#if defined(__linux__)
+		for (int fd : fds) {
+			if (fd >= 0) {
+				::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+				::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+			}
+		}
+#endif
+	}
+
+	//Counts since start(), scaled up when the kernel multiplexed a counter.
+	Sample stop() {
+		Sample sample;
+		for (int event = 0; event < EventCount; ++event) {
+			sample.values[event] = 0;
+			sample.valid[event] = false;
+#if defined(__linux__)
+			int fd = fds[event];
+			if (fd < 0)
+				continue;
+			::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+			uint64_t data[3];
+			if (::read(fd, data, sizeof(data)) != static_cast<ssize_t>(sizeof(data)) || data[2] == 0)
+				continue;
+			sample.values[event] = static_cast<double>(data[0]) * static_cast<double>(data[1]) / static_cast<double>(data[2]);
+			sample.valid[event] = true;
+#endif
+		}
+		return sample;
+	}
+};
+
+#endif
@@ -0,0 +1,147 @@
+//Single-threaded serialization throughput per corpus shape, with hardware counters.
+//  g++ -O2 -std=c++17 -pthread -I.. WriterBench.cpp -o WriterBench
+//Usage: WriterBench [secondsPerShape]
+//Cycles, IPC and misses come from perf_event_open; when the kernel does not allow
+//it (see /proc/sys/kernel/perf_event_paranoid) those columns show "n/a".
+#include "../JsonWriter.h"
+#include "PerfCounters.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+namespace
+{
+	//Discards the output, counting it; keeps the stream cost close to a real sink.
+	class CountingBuffer : public std::streambuf {
+	private:
+		char buffer[1 << 16];
+		unsigned long long flushed = 0;
+	protected:
+		virtual int_type overflow(int_type ch) override {
+			flushed += static_cast<unsigned long long>(pptr() - pbase());
+			setp(buffer, buffer + sizeof(buffer));
+			if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+				*pptr() = traits_type::to_char_type(ch);
+				pbump(1);
+			}
+			return traits_type::not_eof(ch);
+		}
+	public:
+		CountingBuffer() {
+			setp(buffer, buffer + sizeof(buffer));
+		}
+
+		unsigned long long size() const {
+			return flushed + static_cast<unsigned long long>(pptr() - pbase());
+		}
+	};
+
+	struct Shape {
+		const char* name;
+		const Json::Node* doc;
+	};
+
+	Json::Object flat() {
+		Json::Object doc;
+		for (int i = 0; i < 32; ++i) {
+			std::string name = "member" + std::to_string(i);
+			switch (i % 4) {
+			case 0: doc(name, i * 1000003); break;
+			case 1: doc(name, i * 0.125); break;
+			case 2: doc(name, "value" + std::to_string(i)); break;
+			default: doc(name, i % 2 == 0); break;
+			}
+		}
+		return doc;
+	}
+
+	Json::Object nested(int depth) {
+		Json::Object doc;
+		doc("id", depth)("kind", "node")("weight", depth * 1.5);
+		if (depth > 0)
+			doc("left", nested(depth - 1))("right", nested(depth - 1));
+		return doc;
+	}
+
+	Json::Array<std::string> strings() {
+		Json::Array<std::string> doc;
+		for (int i = 0; i < 256; ++i)
+			doc("/var/log/service-" + std::to_string(i) + "/events \"rotated\" at shard " + std::to_string(i * 7));
+		return doc;
+	}
+
+	Json::Array<double> numbers() {
+		Json::Array<double> doc;
+		for (int i = 0; i < 4096; ++i)
+			doc(i * 0.731 - 1000);
+		return doc;
+	}
+
+	Json::Table<int, std::string, double> table() {
+		Json::Table<int, std::string, double> doc({ "id", "host", "load" });
+		for (int i = 0; i < 1024; ++i)
+			doc(i, "host-" + std::to_string(i % 64), i * 0.01);
+		return doc;
+	}
+
+	void printCounter(const PerfCounters::Sample& sample, PerfCounters::Event event, double per) {
+		if (sample.valid[event])
+			std::printf(" %10.3f", sample.values[event] / per);
+		else
+			std::printf(" %10s", "n/a");
+	}
+}
+
+int main(int argc, char** argv) {
+	double seconds = argc > 1 ? std::atof(argv[1]) : 1.0;
+
+	Json::Object flatDoc = flat();
+	Json::Object nestedDoc = nested(8);
+	Json::Array<std::string> stringDoc = strings();
+	Json::Array<double> numberDoc = numbers();
+	Json::Table<int, std::string, double> tableDoc = table();
+	const Shape shapes[] = {
+		{ "flat", &flatDoc },
+		{ "nested", &nestedDoc },
+		{ "strings", &stringDoc },
+		{ "numbers", &numberDoc },
+		{ "table", &tableDoc },
+	};
+
+	PerfCounters counters;
+	if (!counters.any())
+		std::printf("hardware counters unavailable (%s), wall clock only\n", counters.unavailableReason().c_str());
+	std::printf("%8s %10s %10s %10s %10s %10s %10s %10s\n",
+		"shape", "MB/s", "ns/B", "cycles/B", "IPC", "brmiss/KB", "L1miss/KB", "LLCmiss/KB");
+
+	for (const Shape& shape : shapes) {
+		const Json::Node& doc = *shape.doc;
+		CountingBuffer buffer;
+		std::ostream os(&buffer);
+		os << doc;
+
+		unsigned long long before = buffer.size();
+		auto begin = std::chrono::steady_clock::now();
+		auto deadline = begin + std::chrono::duration<double>(seconds);
+		counters.start();
+		do {
+			for (int i = 0; i < 16; ++i)
+				os << doc;
+		} while (std::chrono::steady_clock::now() < deadline);
+		PerfCounters::Sample sample = counters.stop();
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+		double bytes = static_cast<double>(buffer.size() - before);
+
+		std::printf("%8s %10.1f %10.3f", shape.name, bytes / elapsed / 1e6, elapsed * 1e9 / bytes);
+		printCounter(sample, PerfCounters::Cycles, bytes);
+		if (sample.valid[PerfCounters::Cycles] && sample.valid[PerfCounters::Instructions])
+			std::printf(" %10.2f", sample.ipc());
+		else
+			std::printf(" %10s", "n/a");
+		printCounter(sample, PerfCounters::BranchMisses, bytes / 1024);
+		printCounter(sample, PerfCounters::L1Misses, bytes / 1024);
+		printCounter(sample, PerfCounters::LlcMisses, bytes / 1024);
+		std::printf("\n");
+	}
+	return 0;
+}
@@ -0,0 +1,91 @@
+//Concurrent reads of a shared document: lookups on several threads must agree on every
+//member while the first of them builds the object's name index, and overlays sharing a
+//defaults object must write the same text on every thread. Run under
+//-fsanitize=thread to catch races on the index itself.
+#include "../JsonWriter.h"
+#include <cstdio>
+
+namespace
+{
+	int failures = 0;
+
+	const int members = 64;
+	const int threads = 4;
+
+	void fail(const char* what, int at) {
+		if (failures++ < 10)
+			std::printf("FAIL %s: %d\n", what, at);
+	}
+
+	//Each round starts from a fresh copy, which has no index yet.
+	void lookups(const Json::Object& original) {
+		for (int round = 0; round < 50; ++round) {
+			Json::Object object = original;
+			std::atomic<int> waiting{ threads };
+			std::vector<std::thread> pool;
+			std::vector<int> wrong(threads, 0);
+			for (int t = 0; t < threads; ++t)
+				pool.emplace_back([&, t] {
+					--waiting;
+					while (waiting.load())
+						std::this_thread::yield();
+					for (int i = 0; i < members; ++i) {
+						int member = (i + t * 17) % members;
+						std::string name = "m" + std::to_string(member);
+						const int* value = (t % 2 ? object.find(name) : object.pointer("/" + name)).as<int>();
+						if (!value || *value != member)
+							++wrong[t];
+					}
+					if (object.find("absent"))
+						++wrong[t];
+				});
+			for (std::thread& thread : pool)
+				thread.join();
+			for (int t = 0; t < threads; ++t)
+				if (wrong[t])
+					fail("lookup on a shared object", round);
+		}
+	}
+
+	//Overlays on different threads share the defaults; each overrides every third member.
+	void overlays(const Json::Object& original) {
+		Json::Object defaults = original;
+		Json::Object overrides;
+		for (int i = 0; i < members; i += 3)
+			overrides("m" + std::to_string(i), -i);
+		std::string expected;
+		for (int i = 0; i < members; ++i)
+			if (i % 3)
+				expected += ",\"m" + std::to_string(i) + "\":" + std::to_string(i);
+		for (int i = 0; i < members; i += 3)
+			expected += ",\"m" + std::to_string(i) + "\":" + std::to_string(-i);
+		expected = "{" + expected.substr(1) + "}";
+
+		std::vector<std::string> written(threads);
+		std::vector<std::thread> pool;
+		for (int t = 0; t < threads; ++t)
+			pool.emplace_back([&, t] {
+				Json::Overlay overlay;
+				overlay(defaults)(overrides);
+				std::ostringstream os;
+				os << overlay;
+				written[t] = os.str();
+			});
+		for (std::thread& thread : pool)
+			thread.join();
+		for (int t = 0; t < threads; ++t)
+			if (written[t] != expected)
+				fail("overlay over shared defaults", t);
+	}
+}
+
+int main() {
+	Json::Object object;
+	for (int i = 0; i < members; ++i)
+		object("m" + std::to_string(i), i);
+	lookups(object);
+	overlays(object);
+	if (failures)
+		std::printf("%d failures\n", failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,75 @@
+//appendMinified, whose scanners take 16 bytes at a time with SSE2, against a byte-by-byte
+//reference minifier on random JSON-like text and on hand-placed chunk-boundary cases.
+#include "../JsonWriter.h"
+#include <cstdio>
+#include <random>
+
+namespace
+{
+	std::string reference(const std::string& text) {
+		std::string out;
+		bool inString = false;
+		for (size_t i = 0; i < text.size(); ++i) {
+			char ch = text[i];
+			if (inString) {
+				out += ch;
+				if (ch == '\\' && i + 1 < text.size())
+					out += text[++i];
+				else if (ch == '\"')
+					inString = false;
+			}
+			else if (ch == '\"') {
+				out += ch;
+				inString = true;
+			}
+			else if (static_cast<unsigned char>(ch) > 0x20)
+				out += ch;
+		}
+		return out;
+	}
+
+	int failures = 0;
+
+	void check(const std::string& text) {
+		std::string out;
+		Json::details::appendMinified(out, text.data(), text.size());
+		std::string expected = reference(text);
+		if (out != expected && failures++ < 10)
+			std::printf("FAIL input [%s]\n  got      [%s]\n  expected [%s]\n", text.c_str(), out.c_str(), expected.c_str());
+	}
+}
+
+int main() {
+	//An escaped quote, an escaped backslash before a quote, and whitespace, each placed
+	//on every position around the 16- and 32-byte chunk edges.
+	const char* pieces[] = { "\\\"", "\\\\\"", " \t\n", "\\" };
+	for (const char* piece : pieces) {
+		for (size_t offset = 0; offset < 40; ++offset) {
+			std::string text = "\"" + std::string(offset, 'a') + piece + "b c\" , [ 1 , 2 ]";
+			check(text);
+			check(std::string(offset, ' ') + text);
+		}
+	}
+
+	//Strings that end in a backslash, with and without a closing quote.
+	for (size_t length = 0; length < 40; ++length) {
+		check("{ \"k\" : \"" + std::string(length, 'x') + "\\");
+		check("[ \"" + std::string(length, 'x') + "\\\\\" ]");
+		check("\"" + std::string(length, 'x') + "\\\"");
+	}
+
+	std::mt19937 random(12345);
+	const char alphabet[] = "\"\\ \t\n\r{}[]:,ab01\x01\x7f\xff";
+	std::uniform_int_distribution<size_t> pick(0, sizeof(alphabet) - 2);
+	std::uniform_int_distribution<size_t> length(0, 100);
+	for (int i = 0; i < 200000; ++i) {
+		std::string text(length(random), ' ');
+		for (char& ch : text)
+			ch = alphabet[pick(random)];
+		check(text);
+	}
+
+	if (failures)
+		std::printf("%d failures\n", failures);
+	return failures ? 1 : 0;
+}
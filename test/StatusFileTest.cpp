@@ -0,0 +1,111 @@
+//StatusFile slot updates: every state a reader can observe between two word stores of
+//details::updateSlot must still hold one JSON integer, and the file must read back
+//as the document with the latest values.
+#include "../JsonStatus.h"
+#include <climits>
+#include <cstdio>
+#include <fstream>
+#include <random>
+
+namespace
+{
+	int failures = 0;
+
+	void fail(const char* what, long long before, long long after, const char* slot) {
+		if (failures++ < 10)
+			std::printf("FAIL %s: %lld -> %lld [%.*s]\n", what, before, after, static_cast<int>(Json::details::slotWidth), slot);
+	}
+
+	//-?(0|[1-9][0-9]*) followed by spaces up to the slot's end.
+	bool holdsInteger(const char* slot) {
+		size_t at = 0;
+		if (slot[at] == '-')
+			++at;
+		if (at >= Json::details::slotWidth || slot[at] < '0' || slot[at] > '9')
+			return false;
+		if (slot[at++] != '0')
+			while (at < Json::details::slotWidth && slot[at] >= '0' && slot[at] <= '9')
+				++at;
+		while (at < Json::details::slotWidth && slot[at] == ' ')
+			++at;
+		return at == Json::details::slotWidth;
+	}
+
+	void transition(long long before, long long after) {
+		alignas(8) char slot[Json::details::slotWidth];
+		std::memset(slot, ' ', sizeof(slot));
+		std::to_chars(slot, slot + sizeof(slot), before);
+		alignas(8) char expected[Json::details::slotWidth];
+		std::memset(expected, ' ', sizeof(expected));
+		std::to_chars(expected, expected + sizeof(expected), after);
+
+		Json::details::updateSlot(slot, before, after, [&](uint64_t* word, uint64_t bits) {
+			*word = bits;
+			if (!holdsInteger(slot))
+				fail("intermediate state", before, after, slot);
+		});
+		if (std::memcmp(slot, expected, sizeof(slot)) != 0)
+			fail("final state", before, after, slot);
+	}
+
+	std::string slurp(const std::string& path) {
+		std::ifstream in(path, std::ios::binary);
+		return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	}
+
+	std::string minified(const std::string& text) {
+		std::string out;
+		Json::details::appendMinified(out, text.data(), text.size());
+		return out;
+	}
+}
+
+int main() {
+	//Every length change in both directions, positive and negative, plus the extremes.
+	std::vector<long long> edges = { 0, 1, -1, 9, 10, -10, LLONG_MAX, LLONG_MIN, LLONG_MIN + 1 };
+	for (long long power = 10, step = 1; step < 19; ++step, power *= 10) {
+		edges.push_back(power - 1);
+		edges.push_back(power);
+		edges.push_back(-(power - 1));
+		edges.push_back(-power);
+	}
+	for (long long before : edges)
+		for (long long after : edges)
+			transition(before, after);
+
+	//Random transitions: growing, shrinking and sign changes over all magnitudes.
+	std::mt19937_64 random(42);
+	auto pick = [&random]() {
+		long long value = static_cast<long long>(random() >> (1 + random() % 63));
+		return random() & 1 ? -value : value;
+	};
+	for (int i = 0; i < 200000; ++i)
+		transition(pick(), pick());
+
+	//End to end: the mapped file reads back as the document with the current values.
+	std::string path = "StatusFileTest.json";
+	{
+		Json::StatusFile status(path);
+		Json::Slot requests = status.slot();
+		Json::Slot errors = status.slot(-5);
+		Json::Object doc;
+		doc("service", "ingest")("requests", requests)("nested", Json::Object()("errors", errors)("list", { 1, 2 }));
+		status.publish(doc);
+
+		long long values[][2] = { { 7, -5 }, { 1234567890123LL, LLONG_MIN }, { 2, 0 }, { -31, LLONG_MAX } };
+		for (auto& pair : values) {
+			status.set(requests, pair[0]);
+			status.set(errors, pair[1]);
+			std::string expected = "{\"service\":\"ingest\",\"requests\":" + std::to_string(pair[0])
+				+ ",\"nested\":{\"errors\":" + std::to_string(pair[1]) + ",\"list\":[1,2]}}";
+			std::string text = slurp(path);
+			if (minified(text) != expected && failures++ < 10)
+				std::printf("FAIL file [%s]\n  expected [%s]\n", text.c_str(), expected.c_str());
+		}
+	}
+	std::remove(path.c_str());
+
+	if (failures)
+		std::printf("%d failures\n", failures);
+	return failures ? 1 : 0;
+}